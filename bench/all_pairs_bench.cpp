@@ -0,0 +1,100 @@
+// Сравнение времени построения таблиц всех пар: graph::Router (Флойд-Уоршелл
+// по вложенным векторам, один поток) и graph::BlockedRouter (блочный, на
+// thread_count потоках) на случайных графах заданных размеров.
+//
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -pthread -I. bench/all_pairs_bench.cpp -o all_pairs_bench
+//   ./all_pairs_bench [thread_count] [vertex_count ...]
+// По умолчанию thread_count - число ядер, размеры - 1000 5000 10000
+
+#include "router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Graph = graph::DirectedWeightedGraph<double>;
+
+// Ребер на вершину, примерно как у остановки в модели пар вершин
+constexpr size_t EDGES_PER_VERTEX = 4;
+constexpr size_t CHECKED_ROUTES = 1000;
+
+// Случайный граф: из каждой вершины ребра в EDGES_PER_VERTEX случайных вершин
+Graph MakeGraph(size_t vertex_count, std::mt19937& generator) {
+    Graph graph(vertex_count);
+    std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+    std::uniform_real_distribution<double> weight(1.0, 100.0);
+    for (size_t from = 0; from < vertex_count; ++from) {
+        for (size_t i = 0; i < EDGES_PER_VERTEX; ++i) {
+            graph.AddEdge({from, vertex(generator), weight(generator)});
+        }
+    }
+    graph.Freeze();
+    return graph;
+}
+
+template <typename Builder>
+double MeasureSeconds(Builder builder) {
+    const auto start = std::chrono::steady_clock::now();
+    builder();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> vertex_counts = {1000, 5000, 10000};
+    if (argc > 1) {
+        thread_count = std::strtoul(argv[1], nullptr, 10);
+    }
+    if (argc > 2) {
+        vertex_counts.assign(argc - 2, 0);
+        for (int i = 2; i < argc; ++i) {
+            vertex_counts[i - 2] = std::strtoul(argv[i], nullptr, 10);
+        }
+    }
+
+    std::cout << "threads: " << thread_count << std::endl;
+    std::mt19937 generator(42);
+    for (size_t vertex_count : vertex_counts) {
+        const Graph graph = MakeGraph(vertex_count, generator);
+
+        std::optional<graph::Router<double>> router;
+        const double router_seconds = MeasureSeconds([&] {
+            router.emplace(graph);
+        });
+        std::optional<graph::BlockedRouter<double>> blocked_router;
+        const double blocked_seconds = MeasureSeconds([&] {
+            blocked_router.emplace(graph, thread_count);
+        });
+
+        // Оба движка должны находить пути одного веса
+        std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+        size_t mismatch_count = 0;
+        for (size_t i = 0; i < CHECKED_ROUTES; ++i) {
+            const size_t from = vertex(generator);
+            const size_t to = vertex(generator);
+            const auto expected = router->BuildRoute(from, to);
+            const auto actual = blocked_router->BuildRoute(from, to);
+            if (expected.has_value() != actual.has_value()
+                || (expected && std::abs(expected->weight - actual->weight) > 1e-9 * expected->weight)) {
+                ++mismatch_count;
+            }
+        }
+
+        std::cout << "vertices: " << vertex_count
+                  << ", Router: " << router_seconds << " s"
+                  << ", BlockedRouter: " << blocked_seconds << " s"
+                  << ", speedup: " << router_seconds / blocked_seconds
+                  << ", mismatches: " << mismatch_count << " of " << CHECKED_ROUTES << std::endl;
+    }
+}
\ No newline at end of file
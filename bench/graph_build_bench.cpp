@@ -0,0 +1,95 @@
+// Время построения графа маршрутов (TransportRouter::CreateGraph) на большой
+// сгенерированной сети в модели stop_pairs с движком on_demand, который
+// ничего не предвычисляет. Автобусы ходят по общим коридорам, поэтому
+// среди ребер-проездов много параллельных.
+//
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -pthread -I. bench/graph_build_bench.cpp transport_catalogue.cpp geo.cpp -o graph_build_bench
+//   ./graph_build_bench [thread_count] [bus_count]
+// По умолчанию thread_count - число ядер, 2000 автобусов
+
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace transport_catalogue;
+
+namespace{
+
+constexpr size_t STOP_COUNT = 5000;
+constexpr size_t CORRIDOR_COUNT = 300;
+constexpr size_t CORRIDOR_LENGTH = 80;
+constexpr size_t MIN_BUS_LENGTH = 40;
+constexpr int REPEAT_COUNT = 3;
+
+// Коридор - последовательность остановок с заданными расстояниями, автобус
+// проходит по отрезку коридора
+void FillCatalogue(TransportCatalogue& catalogue, size_t bus_count){
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> coordinate(0.0, 0.3);
+    for(size_t i = 0; i < STOP_COUNT; ++i){
+        catalogue.AddStop("Stop " + std::to_string(i), {55.6 + coordinate(generator), 37.4 + coordinate(generator)});
+    }
+    std::uniform_int_distribution<size_t> stop_index(0, STOP_COUNT - 1);
+    std::uniform_int_distribution<int> distance(300, 3000);
+    std::vector<std::vector<std::string>> corridors(CORRIDOR_COUNT);
+    for(auto& corridor : corridors){
+        while(corridor.size() < CORRIDOR_LENGTH){
+            std::string name = "Stop " + std::to_string(stop_index(generator));
+            if(!corridor.empty() && corridor.back() == name){
+                continue;
+            }
+            if(!corridor.empty()){
+                catalogue.AddStopDistance(corridor.back(), name, distance(generator));
+            }
+            corridor.push_back(std::move(name));
+        }
+    }
+    std::uniform_int_distribution<size_t> corridor_index(0, CORRIDOR_COUNT - 1);
+    std::uniform_int_distribution<size_t> length(MIN_BUS_LENGTH, CORRIDOR_LENGTH);
+    for(size_t bus = 0; bus < bus_count; ++bus){
+        const auto& corridor = corridors[corridor_index(generator)];
+        const size_t bus_length = length(generator);
+        const size_t begin = std::uniform_int_distribution<size_t>(0, CORRIDOR_LENGTH - bus_length)(generator);
+        std::vector<std::string_view> route(corridor.begin() + begin, corridor.begin() + begin + bus_length);
+        catalogue.AddBus("Bus " + std::to_string(bus), std::move(route), true);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]){
+    const size_t thread_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+                                         : std::max(1u, std::thread::hardware_concurrency());
+    const size_t bus_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+
+    TransportCatalogue catalogue;
+    FillCatalogue(catalogue, bus_count);
+
+    transport_router::RoutingSettings settings;
+    settings.bus_wait_time_ = 6;
+    settings.bus_velocity_ = 40;
+    settings.engine_ = transport_router::RouterEngine::ON_DEMAND;
+    settings.thread_count_ = thread_count;
+
+    double best_seconds = 0;
+    for(int i = 0; i < REPEAT_COUNT; ++i){
+        // Размер графа до и после сжатия пишется в std::clog один раз
+        settings.log_graph_stats_ = i == 0;
+        transport_router::TransportRouter<double> router;
+        router.SetSettings(settings);
+        const auto start = std::chrono::steady_clock::now();
+        router.CreateGraph(catalogue);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best_seconds = i == 0 ? seconds : std::min(best_seconds, seconds);
+    }
+    std::cout << "threads: " << thread_count << ", buses: " << bus_count
+              << ", CreateGraph: " << best_seconds << " s (best of " << REPEAT_COUNT << ")" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+// Скорость поиска по названию в каталоге: прежний поиск по хеш-таблицам с ключами
+// std::string (count, затем at, с копией названия в строку при каждом обращении),
+// FindStop и FindBus по хеш-таблицам с ключами string_view и после FreezeNames()
+// по совершенному хешу PerfectHashIndex.
+//
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -I. bench/name_lookup_bench.cpp transport_catalogue.cpp geo.cpp -o name_lookup_bench
+//   ./name_lookup_bench [name_count ...]
+// По умолчанию 1000, 10000 и 100000 остановок и столько же маршрутов
+
+#include "transport_catalogue.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace transport_catalogue;
+
+namespace{
+
+constexpr size_t LOOKUP_COUNT = 2000000;
+// Доля запросов с названием, которого нет в каталоге
+constexpr double MISS_RATE = 0.1;
+
+// Сумма номеров найденного записывается сюда, чтобы компилятор не выбросил поиск
+volatile size_t checksum_sink = 0;
+
+// Миллионы поисков в секунду
+template<typename Find>
+double MeasureLookups(const std::vector<std::string>& queries, Find find){
+    size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for(const std::string& query : queries){
+        checksum += find(query);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    checksum_sink = checksum;
+    return queries.size() / seconds / 1e6;
+}
+
+// Поиск, как он был устроен до ключей string_view: название приходит
+// как string_view и для каждого обращения к таблице копируется в std::string
+template<typename Item>
+class StringKeyIndex{
+public:
+    template<typename Items>
+    explicit StringKeyIndex(const Items& items){
+        for(const Item& item : items){
+            name_to_item_[item.name] = &item;
+        }
+    }
+
+    const Item* Find(std::string_view name) const{
+        if(name_to_item_.count(std::string(name))){
+            return name_to_item_.at(std::string(name));
+        }
+        return nullptr;
+    }
+
+private:
+    std::unordered_map<std::string, const Item*> name_to_item_;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]){
+    std::vector<size_t> name_counts = {1000, 10000, 100000};
+    if(argc > 1){
+        name_counts.clear();
+        for(int i = 1; i < argc; ++i){
+            name_counts.push_back(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    std::mt19937 generator(7);
+    for(size_t name_count : name_counts){
+        TransportCatalogue catalogue;
+        std::vector<std::string> stop_names;
+        std::vector<std::string> bus_names;
+        for(size_t i = 0; i < name_count; ++i){
+            stop_names.push_back("Stop street " + std::to_string(i * 7919));
+            catalogue.AddStop(stop_names.back(), {55.0, 37.0});
+        }
+        for(size_t i = 0; i < name_count; ++i){
+            bus_names.push_back(std::to_string(i * 31) + "K");
+            catalogue.AddBus(bus_names.back(), {stop_names[i]}, true);
+        }
+
+        // Запросы - копии названий, чтобы не совпадать с ними по адресу
+        std::uniform_int_distribution<size_t> index(0, name_count - 1);
+        std::bernoulli_distribution is_miss(MISS_RATE);
+        std::vector<std::string> stop_queries;
+        std::vector<std::string> bus_queries;
+        for(size_t i = 0; i < LOOKUP_COUNT; ++i){
+            const bool miss = is_miss(generator);
+            stop_queries.push_back(miss ? "Unknown stop " + std::to_string(i) : stop_names[index(generator)]);
+            bus_queries.push_back(miss ? "Unknown bus " + std::to_string(i) : bus_names[index(generator)]);
+        }
+
+        const StringKeyIndex<Stop> old_stops(catalogue.GetStops());
+        const StringKeyIndex<Bus> old_buses(catalogue.GetBuses());
+        const auto find_old_stop = [&old_stops](const std::string& name) -> size_t{
+            const Stop* stop = old_stops.Find(name);
+            return stop ? stop->id : 0;
+        };
+        const auto find_old_bus = [&old_buses](const std::string& name) -> size_t{
+            const Bus* bus = old_buses.Find(name);
+            return bus ? bus->id : 0;
+        };
+        const auto find_stop = [&catalogue](const std::string& name) -> size_t{
+            const Stop* stop = catalogue.FindStop(name);
+            return stop ? stop->id : 0;
+        };
+        const auto find_bus = [&catalogue](const std::string& name) -> size_t{
+            const Bus* bus = catalogue.FindBus(name);
+            return bus ? bus->id : 0;
+        };
+
+        const double stop_old = MeasureLookups(stop_queries, find_old_stop);
+        const double bus_old = MeasureLookups(bus_queries, find_old_bus);
+        const double stop_map = MeasureLookups(stop_queries, find_stop);
+        const double bus_map = MeasureLookups(bus_queries, find_bus);
+        catalogue.FreezeNames();
+        const double stop_frozen = MeasureLookups(stop_queries, find_stop);
+        const double bus_frozen = MeasureLookups(bus_queries, find_bus);
+
+        std::cout << "names: " << name_count << ", M lookups/s"
+                  << " - FindStop: " << stop_old << " -> " << stop_map << " -> " << stop_frozen
+                  << ", FindBus: " << bus_old << " -> " << bus_map << " -> " << bus_frozen
+                  << " (string count+at -> string_view hash map -> FreezeNames)" << std::endl;
+    }
+}
\ No newline at end of file
@@ -1,16 +1,24 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
-#include <set>
 #include "geo.h"
 
 namespace transport_catalogue{
 
 namespace domain{
 
+// Плотные номера остановок и маршрутов в порядке добавления в каталог
+using StopId = uint32_t;
+using BusId = uint32_t;
+
 struct Stop{
 	std::string name;
 	geo::Coordinates coords;
+	StopId id = 0;
 };
 
 
@@ -18,11 +26,13 @@ struct Bus{
 	std::string name;
 	std::vector<const Stop*> stops;
     bool is_roundtrip = false;
+	BusId id = 0;
 };
 
+// Названия маршрутов ссылаются на строки каталога и отсортированы
 struct StopInfo{
 	bool is_find = false;
-	std::set<std::string> buses {};
+	std::vector<std::string_view> buses {};
 };
 
 struct BusInfo{
@@ -33,11 +43,14 @@ struct BusInfo{
 	double curvature = 0;
 };
 
-struct StopsPtrPairHasher{
-    size_t operator()(const std::pair<const Stop*, const Stop*>& value) const{
-        return std::hash<const void*>{}(value.first) * 37 + std::hash<const void*>{}(value.second);
-    } 
-};
+// Ключ расстояния между парой остановок: номер первой в старших 32 битах
+inline uint64_t MakeStopPairKey(StopId from, StopId to){
+    return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+inline std::pair<StopId, StopId> SplitStopPairKey(uint64_t key){
+    return {static_cast<StopId>(key >> 32), static_cast<StopId>(key)};
+}
 
 } // namespace domain
 
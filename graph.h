@@ -2,7 +2,13 @@
 
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
@@ -17,43 +23,141 @@ struct Edge {
     Weight weight;
 };
 
+// Исходящая дуга вершины: все, что нужно для релаксации, без обращения к edges_
+template <typename Weight>
+struct Arc {
+    VertexId to;
+    Weight weight;
+    EdgeId edge_id;
+};
+
+// Итератор по номерам ребер непрерывного массива дуг
+template <typename Weight>
+class IncidentEdgeIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = EdgeId;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const EdgeId*;
+    using reference = const EdgeId&;
+
+    IncidentEdgeIterator() = default;
+    explicit IncidentEdgeIterator(const Arc<Weight>* arc)
+        : arc_(arc) {
+    }
+
+    reference operator*() const {
+        return arc_->edge_id;
+    }
+    pointer operator->() const {
+        return &arc_->edge_id;
+    }
+    IncidentEdgeIterator& operator++() {
+        ++arc_;
+        return *this;
+    }
+    IncidentEdgeIterator operator++(int) {
+        IncidentEdgeIterator old = *this;
+        ++arc_;
+        return old;
+    }
+    bool operator==(const IncidentEdgeIterator& other) const {
+        return arc_ == other.arc_;
+    }
+    bool operator!=(const IncidentEdgeIterator& other) const {
+        return arc_ != other.arc_;
+    }
+
+private:
+    const Arc<Weight>* arc_ = nullptr;
+};
+
+// Пока граф строится, дуги хранятся в отдельном векторе для каждой вершины.
+// После Freeze() они упаковываются в CSR (compressed sparse row):
+// общий массив дуг, упорядоченный по начальной вершине, и массив смещений.
+// Добавлять ребра в замороженный граф нельзя
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
-    using IncidenceList = std::vector<EdgeId>;
-    using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using IncidenceList = std::vector<Arc<Weight>>;
+    using IncidentEdgesRange = ranges::Range<IncidentEdgeIterator<Weight>>;
+    using ArcsRange = ranges::Range<const Arc<Weight>*>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    void Freeze();
 
+    bool IsFrozen() const;
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    ArcsRange GetOutgoingArcs(VertexId vertex) const;
+
+    // Сохранение и загрузка в двоичном виде, Writer и Reader - см. serialization.h
+    template <typename Writer>
+    void Save(Writer& writer) const;
+    template <typename Reader>
+    static DirectedWeightedGraph Load(Reader& reader);
+
+    // Примерный объем памяти замороженного графа в байтах
+    static size_t EstimateMemory(size_t vertex_count, size_t edge_count) {
+        return edge_count * (sizeof(Edge<Weight>) + sizeof(Arc<Weight>)) + (vertex_count + 1) * sizeof(size_t);
+    }
 
 private:
+    size_t vertex_count_ = 0;
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
+
+    // CSR: дуги вершины v - arcs_[arc_offsets_[v], arc_offsets_[v + 1])
+    std::vector<size_t> arc_offsets_;
+    std::vector<Arc<Weight>> arcs_;
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : vertex_count_(vertex_count)
+    , incidence_lists_(vertex_count) {
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (IsFrozen()) {
+        throw std::logic_error("Can't add an edge to a frozen graph");
+    }
     edges_.push_back(edge);
     const EdgeId id = edges_.size() - 1;
-    incidence_lists_.at(edge.from).push_back(id);
+    incidence_lists_.at(edge.from).push_back({edge.to, edge.weight, id});
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (IsFrozen()) {
+        return;
+    }
+    arc_offsets_.reserve(vertex_count_ + 1);
+    arcs_.reserve(edges_.size());
+    arc_offsets_.push_back(0);
+    for (IncidenceList& incidence_list : incidence_lists_) {
+        arcs_.insert(arcs_.end(), incidence_list.begin(), incidence_list.end());
+        arc_offsets_.push_back(arcs_.size());
+        IncidenceList().swap(incidence_list);
+    }
+    std::vector<IncidenceList>().swap(incidence_lists_);
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return !arc_offsets_.empty();
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return vertex_count_;
 }
 
 template <typename Weight>
@@ -69,6 +173,247 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-    return ranges::AsRange(incidence_lists_.at(vertex));
+    const ArcsRange arcs = GetOutgoingArcs(vertex);
+    return {IncidentEdgeIterator<Weight>(arcs.begin()), IncidentEdgeIterator<Weight>(arcs.end())};
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::ArcsRange
+DirectedWeightedGraph<Weight>::GetOutgoingArcs(VertexId vertex) const {
+    if (vertex >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (IsFrozen()) {
+        const Arc<Weight>* arcs = arcs_.data();
+        return {arcs + arc_offsets_[vertex], arcs + arc_offsets_[vertex + 1]};
+    }
+    const IncidenceList& incidence_list = incidence_lists_[vertex];
+    return {incidence_list.data(), incidence_list.data() + incidence_list.size()};
+}
+
+template <typename Weight>
+template <typename Writer>
+void DirectedWeightedGraph<Weight>::Save(Writer& writer) const {
+    writer.template Write<uint64_t>(vertex_count_);
+    writer.Write(IsFrozen());
+    writer.WriteVector(edges_);
+    if (IsFrozen()) {
+        writer.WriteVector(arc_offsets_);
+        writer.WriteVector(arcs_);
+    }
+}
+
+template <typename Weight>
+template <typename Reader>
+DirectedWeightedGraph<Weight> DirectedWeightedGraph<Weight>::Load(Reader& reader) {
+    DirectedWeightedGraph graph(reader.template Read<uint64_t>());
+    if (!reader.template Read<bool>()) {
+        for (const Edge<Weight>& edge : reader.template ReadVector<Edge<Weight>>()) {
+            graph.AddEdge(edge);
+        }
+        return graph;
+    }
+    graph.edges_ = reader.template ReadVector<Edge<Weight>>();
+    graph.arc_offsets_ = reader.template ReadVector<size_t>();
+    graph.arcs_ = reader.template ReadVector<Arc<Weight>>();
+    if (graph.arc_offsets_.size() != graph.vertex_count_ + 1 || graph.arcs_.size() != graph.edges_.size()) {
+        throw std::runtime_error("Corrupted graph data");
+    }
+    std::vector<IncidenceList>().swap(graph.incidence_lists_);
+    return graph;
+}
+
+// Индекс связности графа. Компоненты сильной связности находятся алгоритмом Тарьяна
+// и нумеруются в обратном топологическом порядке: ребро между разными компонентами
+// всегда ведет из компоненты с большим номером в компоненту с меньшим.
+// Острова (компоненты слабой связности) не соединены ни одним ребром.
+// Поэтому пути из u в v точно нет, если они на разных островах
+// или номер компоненты u меньше номера компоненты v
+class ComponentIndex {
+public:
+    ComponentIndex() = default;
+    template <typename Weight>
+    explicit ComponentIndex(const DirectedWeightedGraph<Weight>& graph);
+
+    bool IsEmpty() const;
+    size_t GetVertexCount() const;
+    // false - пути из from в to точно нет. Пустой индекс ничего не исключает
+    bool MayReach(VertexId from, VertexId to) const;
+
+    size_t GetStrongComponentCount() const;
+    size_t GetIslandCount() const;
+    uint32_t GetStrongComponent(VertexId vertex) const;
+    uint32_t GetIsland(VertexId vertex) const;
+
+    // Сохранение и загрузка в двоичном виде, Writer и Reader - см. serialization.h
+    template <typename Writer>
+    void Save(Writer& writer) const;
+    template <typename Reader>
+    static ComponentIndex Load(Reader& reader);
+
+private:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    template <typename Weight>
+    void FindStrongComponents(const DirectedWeightedGraph<Weight>& graph);
+    template <typename Weight>
+    void FindIslands(const DirectedWeightedGraph<Weight>& graph);
+
+    // Номера компонент сильной связности и островов по вершинам
+    std::vector<uint32_t> strong_components_;
+    std::vector<uint32_t> islands_;
+    uint32_t strong_component_count_ = 0;
+    uint32_t island_count_ = 0;
+};
+
+template <typename Weight>
+ComponentIndex::ComponentIndex(const DirectedWeightedGraph<Weight>& graph) {
+    FindStrongComponents(graph);
+    FindIslands(graph);
+}
+
+inline bool ComponentIndex::IsEmpty() const {
+    return strong_components_.empty();
+}
+
+inline size_t ComponentIndex::GetVertexCount() const {
+    return strong_components_.size();
+}
+
+inline bool ComponentIndex::MayReach(VertexId from, VertexId to) const {
+    if (IsEmpty()) {
+        return true;
+    }
+    return islands_[from] == islands_[to] && strong_components_[from] >= strong_components_[to];
+}
+
+inline size_t ComponentIndex::GetStrongComponentCount() const {
+    return strong_component_count_;
+}
+
+inline size_t ComponentIndex::GetIslandCount() const {
+    return island_count_;
+}
+
+inline uint32_t ComponentIndex::GetStrongComponent(VertexId vertex) const {
+    return strong_components_.at(vertex);
+}
+
+inline uint32_t ComponentIndex::GetIsland(VertexId vertex) const {
+    return islands_.at(vertex);
+}
+
+// Итеративный алгоритм Тарьяна: рекурсия заменена явным стеком кадров обхода
+template <typename Weight>
+void ComponentIndex::FindStrongComponents(const DirectedWeightedGraph<Weight>& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    strong_components_.assign(vertex_count, NONE);
+    std::vector<uint32_t> order(vertex_count, NONE);
+    std::vector<uint32_t> low_link(vertex_count);
+    std::vector<VertexId> component_stack;
+    // Кадр обхода: вершина и ее следующая непросмотренная дуга
+    std::vector<std::pair<VertexId, const Arc<Weight>*>> frames;
+    uint32_t counter = 0;
+
+    const auto enter = [&](VertexId vertex) {
+        order[vertex] = low_link[vertex] = counter++;
+        component_stack.push_back(vertex);
+        frames.push_back({vertex, graph.GetOutgoingArcs(vertex).begin()});
+    };
+
+    for (VertexId root = 0; root < vertex_count; ++root) {
+        if (order[root] != NONE) {
+            continue;
+        }
+        enter(root);
+        while (!frames.empty()) {
+            const VertexId vertex = frames.back().first;
+            const Arc<Weight>*& arc = frames.back().second;
+            if (arc != graph.GetOutgoingArcs(vertex).end()) {
+                const VertexId to = (arc++)->to;
+                if (order[to] == NONE) {
+                    enter(to);
+                } else if (strong_components_[to] == NONE) {
+                    low_link[vertex] = std::min(low_link[vertex], order[to]);
+                }
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty()) {
+                const VertexId parent = frames.back().first;
+                low_link[parent] = std::min(low_link[parent], low_link[vertex]);
+            }
+            if (low_link[vertex] == order[vertex]) {
+                VertexId member;
+                do {
+                    member = component_stack.back();
+                    component_stack.pop_back();
+                    strong_components_[member] = strong_component_count_;
+                } while (member != vertex);
+                ++strong_component_count_;
+            }
+        }
+    }
+}
+
+// Острова находятся системой непересекающихся множеств по всем ребрам
+// и нумеруются по порядку первых вершин
+template <typename Weight>
+void ComponentIndex::FindIslands(const DirectedWeightedGraph<Weight>& graph) {
+    const size_t vertex_count = graph.GetVertexCount();
+    std::vector<VertexId> parents(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        parents[vertex] = vertex;
+    }
+    const auto find_root = [&parents](VertexId vertex) {
+        while (parents[vertex] != vertex) {
+            vertex = parents[vertex] = parents[parents[vertex]];
+        }
+        return vertex;
+    };
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        const Edge<Weight>& edge = graph.GetEdge(edge_id);
+        const VertexId from_root = find_root(edge.from);
+        const VertexId to_root = find_root(edge.to);
+        parents[std::max(from_root, to_root)] = std::min(from_root, to_root);
+    }
+
+    islands_.assign(vertex_count, NONE);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        const VertexId root = find_root(vertex);
+        if (islands_[root] == NONE) {
+            islands_[root] = island_count_++;
+        }
+        islands_[vertex] = islands_[root];
+    }
+}
+
+template <typename Writer>
+void ComponentIndex::Save(Writer& writer) const {
+    writer.WriteVector(strong_components_);
+    writer.WriteVector(islands_);
+    writer.Write(strong_component_count_);
+    writer.Write(island_count_);
+}
+
+template <typename Reader>
+ComponentIndex ComponentIndex::Load(Reader& reader) {
+    ComponentIndex index;
+    index.strong_components_ = reader.template ReadVector<uint32_t>();
+    index.islands_ = reader.template ReadVector<uint32_t>();
+    index.strong_component_count_ = reader.template Read<uint32_t>();
+    index.island_count_ = reader.template Read<uint32_t>();
+    const auto is_valid = [](const std::vector<uint32_t>& components, uint32_t count) {
+        return std::all_of(components.begin(), components.end(), [count](uint32_t id) {
+            return id < count;
+        });
+    };
+    if (index.islands_.size() != index.strong_components_.size()
+        || !is_valid(index.strong_components_, index.strong_component_count_)
+        || !is_valid(index.islands_, index.island_count_)) {
+        throw std::runtime_error("Corrupted component index data");
+    }
+    return index;
 }
 }  // namespace graph
\ No newline at end of file
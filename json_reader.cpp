@@ -25,6 +25,14 @@ void JsonReader::SendRequests(TransportCatalogue& catalogue){
     request_handler_.ApplyRequests(catalogue);
 }
 
+void JsonReader::MakeBase(TransportCatalogue& catalogue){
+    request_handler_.MakeBase(catalogue);
+}
+
+void JsonReader::ProcessRequests(TransportCatalogue& catalogue){
+    request_handler_.ProcessRequests(catalogue);
+}
+
 void JsonReader::GetResponses(std::ostream& output){
     std::vector<MultiResponse> responses = request_handler_.GetResponses();
     Array json_response;
@@ -44,8 +52,8 @@ void JsonReader::GetResponses(std::ostream& output){
         } else if(multi_response.IsResponseStopInfo()){
             ResponseStopInfo response = multi_response.AsResponseStopInfo(); 
             Array buses;
-            for(std::string bus : response.buses_){
-                buses.push_back(bus);
+            for(std::string_view bus : response.buses_){
+                buses.push_back(std::string(bus));
             }
 
             Node dict = Builder()
@@ -74,31 +82,25 @@ void JsonReader::GetResponses(std::ostream& output){
             .Build();
             json_response.emplace_back(dict);
         } else if(multi_response.IsResponceRoute()){
-            using request_handler::detail::BaseEdgePtr;
-            using request_handler::detail::WaitEdgePtr;
-            using request_handler::detail::BusEdgePtr;
-
             ResponseRoute response = multi_response.AsResponseRoute();
             Array items;
             for(const auto& item : response.items_){
-                if(item->type_ == "Wait"){
-                    WaitEdgePtr wait_edge = static_cast<WaitEdgePtr>(item.get());
+                if(item.type_ == transport_router::EdgeType::WAIT){
                     Node wait_item = Builder()
                         .StartDict()
-                            .Key("stop_name").Value(wait_edge->stop_name_)
-                            .Key("time").Value(wait_edge->time_)
-                            .Key("type").Value(wait_edge->type_)
+                            .Key("stop_name").Value(std::string(item.name_))
+                            .Key("time").Value(item.time_)
+                            .Key("type").Value("Wait"s)
                         .EndDict()
                     .Build();
                     items.push_back(wait_item);
-                } else if(item->type_ == "Bus"){
-                    BusEdgePtr bus_edge = static_cast<BusEdgePtr>(item.get());
+                } else if(item.type_ == transport_router::EdgeType::BUS){
                     Node bus_item = Builder()
                         .StartDict()
-                            .Key("bus").Value(bus_edge->bus_)
-                            .Key("span_count").Value(bus_edge->span_count_)
-                            .Key("time").Value(bus_edge->time_)
-                            .Key("type").Value(bus_edge->type_)
+                            .Key("bus").Value(std::string(item.name_))
+                            .Key("span_count").Value(item.span_count_)
+                            .Key("time").Value(item.time_)
+                            .Key("type").Value("Bus"s)
                         .EndDict()
                     .Build();
                     items.push_back(bus_item);
@@ -113,6 +115,50 @@ void JsonReader::GetResponses(std::ostream& output){
                 .EndDict()
             .Build();
             json_response.emplace_back(dict);
+        } else if(multi_response.IsResponseRouteMatrix()){
+            const ResponseRouteMatrix& response = multi_response.AsResponseRouteMatrix();
+            // Строка матрицы - начальная остановка, столбец - конечная,
+            // null - маршрута нет
+            Array total_times;
+            for(const auto& row : response.total_times_){
+                Array json_row;
+                for(const auto& total_time : row){
+                    if(total_time.has_value()){
+                        json_row.emplace_back(*total_time);
+                    } else {
+                        json_row.emplace_back(nullptr);
+                    }
+                }
+                total_times.emplace_back(std::move(json_row));
+            }
+
+            Node dict = Builder()
+                .StartDict()
+                    .Key("request_id").Value(response.request_id_)
+                    .Key("total_time").Value(std::move(total_times))
+                .EndDict()
+            .Build();
+            json_response.emplace_back(dict);
+        } else if(multi_response.IsResponseReachable()){
+            const ResponseReachable& response = multi_response.AsResponseReachable();
+            Array items;
+            for(const auto& [stop_name, time] : response.stops_){
+                Node item = Builder()
+                    .StartDict()
+                        .Key("stop_name").Value(std::string(stop_name))
+                        .Key("time").Value(time)
+                    .EndDict()
+                .Build();
+                items.push_back(item);
+            }
+
+            Node dict = Builder()
+                .StartDict()
+                    .Key("items").Value(std::move(items))
+                    .Key("request_id").Value(response.request_id_)
+                .EndDict()
+            .Build();
+            json_response.emplace_back(dict);
         }
     }
     Document doc(json_response);
@@ -198,6 +244,11 @@ void JsonReader::ConvertStatRequests(const json::Array& stat_requests){
         Dict requests = node.AsDict();
         std::string type = requests.at("type").AsString();
         int id = requests.at("id").AsInt();
+        // Профиль маршрутизации для Route, RouteMatrix и Reachable, по умолчанию основной
+        std::string profile;
+        if(requests.count("profile")){
+            profile = requests.at("profile").AsString();
+        }
         if(type == "Bus" || type == "Stop"){
             std::string name;
             if(requests.count("name")){
@@ -218,7 +269,22 @@ void JsonReader::ConvertStatRequests(const json::Array& stat_requests){
             if(requests.count("to")){
                 to = requests.at("to").AsString();
             }
-            RequestGetRoute request(from, to, id);
+            RequestGetRoute request(from, to, id, std::move(profile));
+            request_handler_.AddStatRequest(std::move(request));
+        } else if(type == "RouteMatrix"){
+            std::vector<std::string> from;
+            std::vector<std::string> to;
+            for(const Node& stop : requests.at("from").AsArray()){
+                from.push_back(stop.AsString());
+            }
+            for(const Node& stop : requests.at("to").AsArray()){
+                to.push_back(stop.AsString());
+            }
+            RequestGetRouteMatrix request(std::move(from), std::move(to), id, std::move(profile));
+            request_handler_.AddStatRequest(std::move(request));
+        } else if(type == "Reachable"){
+            RequestGetReachable request(requests.at("from").AsString(), requests.at("time").AsDouble(), id,
+                                        std::move(profile));
             request_handler_.AddStatRequest(std::move(request));
         }
     }
@@ -260,9 +326,92 @@ void JsonReader::ConvertRoutingSettings(const json::Dict& routing_settings){
     transport_router::RoutingSettings settings;
     settings.bus_wait_time_ = routing_settings.at("bus_wait_time").AsInt();
     settings.bus_velocity_ = routing_settings.at("bus_velocity").AsInt();
+    if(routing_settings.count("graph_model")){
+        const std::string& graph_model = routing_settings.at("graph_model").AsString();
+        if(graph_model == "stop_pairs"){
+            settings.graph_model_ = transport_router::GraphModel::STOP_PAIRS;
+        } else if(graph_model == "route_patterns"){
+            settings.graph_model_ = transport_router::GraphModel::ROUTE_PATTERNS;
+        } else {
+            throw std::invalid_argument("Unknown routing graph model: "s + graph_model);
+        }
+    }
+    if(routing_settings.count("engine")){
+        const std::string& engine = routing_settings.at("engine").AsString();
+        if(engine == "all_pairs"){
+            settings.engine_ = transport_router::RouterEngine::ALL_PAIRS;
+        } else if(engine == "all_pairs_compact"){
+            settings.engine_ = transport_router::RouterEngine::ALL_PAIRS_COMPACT;
+        } else if(engine == "all_pairs_blocked"){
+            settings.engine_ = transport_router::RouterEngine::ALL_PAIRS_BLOCKED;
+        } else if(engine == "on_demand"){
+            settings.engine_ = transport_router::RouterEngine::ON_DEMAND;
+        } else if(engine == "contraction_hierarchies"){
+            settings.engine_ = transport_router::RouterEngine::CONTRACTION_HIERARCHIES;
+        } else if(engine == "raptor"){
+            settings.engine_ = transport_router::RouterEngine::RAPTOR;
+        } else if(engine == "a_star"){
+            settings.engine_ = transport_router::RouterEngine::A_STAR;
+        } else if(engine == "hub_labels"){
+            settings.engine_ = transport_router::RouterEngine::HUB_LABELS;
+        } else if(engine == "auto"){
+            settings.engine_ = transport_router::RouterEngine::AUTO;
+        } else {
+            throw std::invalid_argument("Unknown routing engine: "s + engine);
+        }
+    }
+    if(routing_settings.count("thread_count")){
+        settings.thread_count_ = routing_settings.at("thread_count").AsInt();
+    }
+    if(routing_settings.count("route_cache_size")){
+        settings.route_cache_size_ = routing_settings.at("route_cache_size").AsInt();
+    }
+    if(routing_settings.count("memory_budget_mb")){
+        settings.memory_budget_mb_ = routing_settings.at("memory_budget_mb").AsInt();
+    }
+    if(routing_settings.count("log_graph_stats")){
+        settings.log_graph_stats_ = routing_settings.at("log_graph_stats").AsBool();
+    }
+    if(routing_settings.count("weights")){
+        const std::string& weights = routing_settings.at("weights").AsString();
+        if(weights == "minutes"){
+            settings.weights_ = transport_router::RouteWeights::MINUTES;
+        } else if(weights == "fixed_point"){
+            settings.weights_ = transport_router::RouteWeights::FIXED_POINT;
+        } else {
+            throw std::invalid_argument("Unknown routing weights: "s + weights);
+        }
+    }
+    if(routing_settings.count("profiles")){
+        for(const Node& node : routing_settings.at("profiles").AsArray()){
+            const Dict& profile = node.AsDict();
+            transport_router::RoutingProfile& routing_profile = settings.profiles_.emplace_back();
+            routing_profile.name_ = profile.at("name").AsString();
+            routing_profile.bus_wait_time_ = profile.at("bus_wait_time").AsInt();
+            routing_profile.bus_velocity_ = profile.at("bus_velocity").AsInt();
+            if(routing_profile.name_.empty()){
+                throw std::invalid_argument("Routing profile name should not be empty");
+            }
+        }
+    }
     request_handler_.AddRoutingSettings(std::move(settings));
 }
 
+void JsonReader::ConvertSerializationSettings(const json::Dict& serialization_settings){
+    serialization::SerializationSettings settings;
+    settings.file_ = serialization_settings.at("file").AsString();
+    request_handler_.AddSerializationSettings(std::move(settings));
+}
+
+void JsonReader::ConvertStatSettings(const json::Dict& stat_settings){
+    if(stat_settings.count("thread_count")){
+        request_handler_.SetStatThreadCount(stat_settings.at("thread_count").AsInt());
+    }
+    if(stat_settings.count("router_warm_up")){
+        request_handler_.SetRouterWarmUp(stat_settings.at("router_warm_up").AsBool());
+    }
+}
+
 void JsonReader::AddConvertedRequests(std::ostringstream& sstream){
     Document document = LoadJSON(sstream.str());
     Dict root_dict = document.GetRoot().AsDict();
@@ -294,6 +443,16 @@ void JsonReader::AddConvertedRequests(std::ostringstream& sstream){
         //Передача настроек маршрутов
         ConvertRoutingSettings(routing_settings);
     }
+
+    if(root_dict.count("serialization_settings")){
+        //Передача настроек файла базы
+        ConvertSerializationSettings(root_dict.at("serialization_settings").AsDict());
+    }
+
+    if(root_dict.count("stat_settings")){
+        //Передача настроек обработки stat_requests
+        ConvertStatSettings(root_dict.at("stat_settings").AsDict());
+    }
 }
 
 } // namespace json_reader
@@ -28,12 +28,18 @@ public:
     // Обработчик запросов
     // отправляет запросы в каталог
     void SendRequests(TransportCatalogue& catalogue);
+    // Режим make_base: сохраняет базу в файл из serialization_settings
+    void MakeBase(TransportCatalogue& catalogue);
+    // Режим process_requests: загружает базу и отвечает на stat_requests
+    void ProcessRequests(TransportCatalogue& catalogue);
     void GetResponses(std::ostream& output);
 private:
     void ConvertBaseRequests(const json::Array& base_requests);
     void ConvertStatRequests(const json::Array& stat_requests);
     void ConvertRenderSettings(const json::Dict& render_settings);
     void ConvertRoutingSettings(const json::Dict& render_settings);
+    void ConvertSerializationSettings(const json::Dict& serialization_settings);
+    void ConvertStatSettings(const json::Dict& stat_settings);
 
     // Обрабаывает JSON-данные и передает 
     // запросы в виде структур данных
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace transport_catalogue{
+
+// Кэш на capacity значений, при переполнении вытесняется
+// значение, к которому дольше всего не обращались.
+// Поиск и добавление - O(1), capacity = 0 - кэш выключен
+template<typename Key, typename Value, typename Hasher = std::hash<Key>>
+class LruCache{
+public:
+    explicit LruCache(size_t capacity = 0)
+    : capacity_(capacity){}
+
+    // Возвращает значение по ключу или nullptr и учитывает попадание или промах.
+    // Найденное значение становится самым свежим
+    const Value* Find(const Key& key){
+        auto it = positions_.find(key);
+        if(it == positions_.end()){
+            ++miss_count_;
+            return nullptr;
+        }
+        ++hit_count_;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    void Put(const Key& key, Value value){
+        if(capacity_ == 0){
+            return;
+        }
+        auto it = positions_.find(key);
+        if(it != positions_.end()){
+            it->second->second = std::move(value);
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if(entries_.size() == capacity_){
+            positions_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        entries_.emplace_front(key, std::move(value));
+        positions_[key] = entries_.begin();
+    }
+
+    // Удаляет все значения, счетчики попаданий и промахов сохраняются
+    void Clear(){
+        entries_.clear();
+        positions_.clear();
+    }
+
+    size_t GetCapacity() const{
+        return capacity_;
+    }
+
+    size_t GetSize() const{
+        return entries_.size();
+    }
+
+    size_t GetHitCount() const{
+        return hit_count_;
+    }
+
+    size_t GetMissCount() const{
+        return miss_count_;
+    }
+
+private:
+    using Entries = std::list<std::pair<Key, Value>>;
+
+    size_t capacity_;
+    // От самого свежего к самому старому
+    Entries entries_;
+    std::unordered_map<Key, typename Entries::iterator, Hasher> positions_;
+    size_t hit_count_ = 0;
+    size_t miss_count_ = 0;
+};
+
+} // namespace transport_catalogue
\ No newline at end of file
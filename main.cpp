@@ -1,6 +1,7 @@
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <fstream>
 
 #include "json_reader.h"
@@ -9,11 +10,37 @@ using namespace std;
 using namespace transport_catalogue;
 using namespace transport_catalogue::json_reader;
 
-int main() {
-    ifstream in("input.json");
-    ofstream out("output.json");
+void PrintUsage(std::ostream& stream = std::cerr) {
+    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+}
+
+int main(int argc, char* argv[]) {
+    // Без аргументов: input.json -> output.json за один запуск
+    if (argc == 1) {
+        ifstream in("input.json");
+        ofstream out("output.json");
+        TransportCatalogue catalogue;
+        JsonReader reader(in);
+        reader.SendRequests(catalogue);
+        reader.GetResponses(out);
+        return 0;
+    }
+
+    if (argc != 2) {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::string_view mode(argv[1]);
     TransportCatalogue catalogue;
-    JsonReader reader(in);
-    reader.SendRequests(catalogue);
-    reader.GetResponses(out);
+    JsonReader reader(cin);
+    if (mode == "make_base"sv) {
+        reader.MakeBase(catalogue);
+    } else if (mode == "process_requests"sv) {
+        reader.ProcessRequests(catalogue);
+        reader.GetResponses(cout);
+    } else {
+        PrintUsage();
+        return 1;
+    }
 }
\ No newline at end of file
@@ -132,7 +132,7 @@ std::vector<svg::Text> MapRender::GetStopsLabels(std::map<std::string_view, cons
     return result;
 }
 
-std::string MapRender::Render(std::map<std::string_view, const domain::Bus*> buses){
+std::string MapRender::Render(std::map<std::string_view, const domain::Bus*> buses) const{
     svg::Document doc;
     std::unordered_set<geo::Coordinates, geo::CoordHasher> geo_points;
     std::map<std::string_view, const domain::Stop*> stops;
@@ -161,6 +161,10 @@ void MapRender::SetSettings(const RenderSettings& settings){
     settings_ = settings;
 }
 
+const RenderSettings& MapRender::GetSettings() const{
+    return settings_;
+}
+
 } // namespace map_render
 
 } // namespace transport_catalogue
\ No newline at end of file
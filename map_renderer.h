@@ -58,8 +58,9 @@ public:
     std::vector<svg::Text> GetBusLabel(std::map<std::string_view, const domain::Bus*>& buses, const SphereProjector& projector) const;
     std::vector<svg::Circle> GetStopsSymbols(std::map<std::string_view, const domain::Stop*>& stops, const SphereProjector& projector) const;
     std::vector<svg::Text> GetStopsLabels(std::map<std::string_view, const domain::Stop*>& stops, const SphereProjector& projector) const;
-    std::string Render(std::map<std::string_view, const domain::Bus*> buses);
+    std::string Render(std::map<std::string_view, const domain::Bus*> buses) const;
     void SetSettings(const RenderSettings& settings);
+    const RenderSettings& GetSettings() const;
 private:
     RenderSettings settings_;
 };
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue{
+
+// Неизменяемый словарь название -> номер на совершенной хеш-функции
+// (hash and displace). Ключи раскладываются по корзинам, для каждой корзины
+// подбирается сид, при котором все ее ключи попадают в свободные ячейки.
+// Поиск - один хеш строки и одно сравнение, без цепочек и без выделения памяти
+class PerfectHashIndex{
+public:
+    static constexpr uint32_t NOT_FOUND = std::numeric_limits<uint32_t>::max();
+
+    // Строит индекс по парам (название, номер). Названия должны быть различны
+    // и жить дольше индекса. false - если сиды подобрать не удалось, индекс пуст
+    bool Build(const std::vector<std::pair<std::string_view, uint32_t>>& entries){
+        Clear();
+        // Около четырех ключей на корзину и пятая часть ячеек в запас
+        const size_t slot_count = entries.size() + entries.size() / 4 + 1;
+        const size_t bucket_count = entries.size() / 4 + 1;
+
+        std::vector<uint64_t> hashes(entries.size());
+        std::vector<std::vector<size_t>> buckets(bucket_count);
+        for(size_t i = 0; i < entries.size(); ++i){
+            hashes[i] = std::hash<std::string_view>{}(entries[i].first);
+            buckets[Mix(hashes[i], 0) % bucket_count].push_back(i);
+        }
+        // Большие корзины размещаются первыми, пока свободных ячеек много
+        std::vector<size_t> order(bucket_count);
+        for(size_t bucket = 0; bucket < bucket_count; ++bucket){
+            order[bucket] = bucket;
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs){
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        std::vector<uint32_t> seeds(bucket_count, 0);
+        std::vector<Slot> slots(slot_count);
+        std::vector<size_t> positions;
+        for(size_t bucket : order){
+            if(buckets[bucket].empty()){
+                break;
+            }
+            bool is_placed = false;
+            for(uint32_t seed = 1; seed <= MAX_SEED && !is_placed; ++seed){
+                positions.clear();
+                is_placed = true;
+                for(size_t key : buckets[bucket]){
+                    const size_t position = Mix(hashes[key], seed) % slot_count;
+                    if(slots[position].id != NOT_FOUND
+                       || std::find(positions.begin(), positions.end(), position) != positions.end()){
+                        is_placed = false;
+                        break;
+                    }
+                    positions.push_back(position);
+                }
+                if(is_placed){
+                    seeds[bucket] = seed;
+                    for(size_t i = 0; i < positions.size(); ++i){
+                        const auto& [name, id] = entries[buckets[bucket][i]];
+                        slots[positions[i]] = {name, id};
+                    }
+                }
+            }
+            // Так бывает, только если у двух названий совпал весь 64-битный хеш
+            if(!is_placed){
+                return false;
+            }
+        }
+        seeds_ = std::move(seeds);
+        slots_ = std::move(slots);
+        return true;
+    }
+
+    // Номер по названию, NOT_FOUND - если названия нет или индекс не построен
+    uint32_t Find(std::string_view name) const{
+        if(seeds_.empty()){
+            return NOT_FOUND;
+        }
+        const uint64_t hash = std::hash<std::string_view>{}(name);
+        const uint32_t seed = seeds_[Mix(hash, 0) % seeds_.size()];
+        const Slot& slot = slots_[Mix(hash, seed) % slots_.size()];
+        return slot.name == name ? slot.id : NOT_FOUND;
+    }
+
+    bool IsBuilt() const{
+        return !seeds_.empty();
+    }
+
+    void Clear(){
+        seeds_.clear();
+        slots_.clear();
+    }
+
+private:
+    struct Slot{
+        std::string_view name;
+        uint32_t id = NOT_FOUND;
+    };
+
+    static constexpr uint32_t MAX_SEED = 1 << 16;
+
+    // Перемешивание хеша с сидом (splitmix64), сид 0 выбирает корзину
+    static uint64_t Mix(uint64_t hash, uint32_t seed){
+        uint64_t value = hash + (seed + 1) * 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    std::vector<uint32_t> seeds_;
+    std::vector<Slot> slots_;
+};
+
+} // namespace transport_catalogue
\ No newline at end of file
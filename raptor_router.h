@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "transport_catalogue.h"
+
+namespace transport_catalogue{
+
+namespace transport_router{
+
+// Поиск маршрута по раундам (RAPTOR) напрямую по последовательностям
+// остановок автобусов, без построения графа. Раунд k находит лучшее
+// время прибытия на остановки не более чем с k посадками. Каждая посадка
+// стоит wait_time, время проезда - расстояние по дорогам, деленное на скорость
+template<typename Weight>
+class RaptorRouter{
+public:
+    // Поездка на одном автобусе от остановки посадки через span_count остановок
+    struct Leg{
+        const Stop* board_stop;
+        const Bus* bus;
+        int span_count;
+        Weight ride_time;
+    };
+
+    struct Journey{
+        Weight total_time;
+        std::vector<Leg> legs;
+    };
+
+    // velocity - скорость в метрах на единицу веса, для вещественных весов - в минуту
+    RaptorRouter(const TransportCatalogue& catalogue, Weight wait_time, double velocity)
+    : wait_time_(wait_time), velocity_(velocity){
+        // Остановки нумеруются так же, как в каталоге
+        const std::deque<Stop>& stops = catalogue.GetStops();
+        stops_.reserve(stops.size());
+        for(const Stop& stop : stops){
+            stops_.push_back(&stop);
+        }
+        stop_routes_.resize(stops_.size());
+
+        for(const Bus& bus : catalogue.GetBuses()){
+            if(bus.stops.size() < 2){
+                continue;
+            }
+            Route route{&bus, {}, {}};
+            int distance = 0;
+            for(size_t pos = 0; pos < bus.stops.size(); ++pos){
+                if(pos > 0){
+                    distance += catalogue.GetDistance(bus.stops[pos - 1], bus.stops[pos]);
+                }
+                const StopId stop_index = bus.stops[pos]->id;
+                route.stops.push_back(stop_index);
+                route.distances.push_back(distance);
+                stop_routes_[stop_index].push_back({routes_.size(), pos});
+            }
+            routes_.push_back(std::move(route));
+        }
+    }
+
+    std::optional<Journey> BuildRoute(StopId from, StopId to) const{
+        const size_t source = from;
+        const size_t target = to;
+        const Rounds rounds = Scan(source, target, INFINITE_TIME);
+        if(rounds.best_arrivals[target] == INFINITE_TIME){
+            return std::nullopt;
+        }
+        return Journey{rounds.best_arrivals[target], RestoreLegs(rounds.labels, source, target)};
+    }
+
+    // Лучшие времена прибытия из from на каждую из остановок to за один проход по раундам
+    std::vector<std::optional<Weight>> BuildArrivalTimes(StopId from, const std::vector<StopId>& to) const{
+        const Rounds rounds = Scan(from, std::nullopt, INFINITE_TIME);
+        std::vector<std::optional<Weight>> result;
+        result.reserve(to.size());
+        for(StopId stop : to){
+            const Weight arrival = rounds.best_arrivals[stop];
+            result.push_back(arrival == INFINITE_TIME ? std::nullopt : std::optional<Weight>(arrival));
+        }
+        return result;
+    }
+
+    // Остановки, на которые из from можно попасть не более чем за max_time, и время прибытия на них
+    std::vector<std::pair<const Stop*, Weight>> BuildReachable(StopId from, Weight max_time) const{
+        const Rounds rounds = Scan(from, std::nullopt, max_time);
+        std::vector<std::pair<const Stop*, Weight>> result;
+        for(size_t stop = 0; stop < stops_.size(); ++stop){
+            if(rounds.best_arrivals[stop] != INFINITE_TIME){
+                result.emplace_back(stops_[stop], rounds.best_arrivals[stop]);
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr Weight ZERO_TIME{};
+    static constexpr Weight INFINITE_TIME = std::numeric_limits<Weight>::max();
+
+    // Маршрут автобуса: номера остановок и расстояние от начала до каждой позиции
+    struct Route{
+        const Bus* bus;
+        std::vector<StopId> stops;
+        std::vector<int> distances;
+    };
+
+    struct RouteStop{
+        size_t route_index;
+        size_t pos;
+    };
+
+    struct Label{
+        size_t route_index;
+        size_t board_pos;
+        size_t alight_pos;
+    };
+
+    // Результат раундов: labels[k][s] - поездка, которой прибытие на s улучшено в раунде k
+    struct Rounds{
+        std::vector<std::vector<std::optional<Label>>> labels;
+        std::vector<Weight> best_arrivals;
+    };
+
+    // Выполняет раунды из source. Если задана target, поездки,
+    // не улучшающие прибытие на нее, отсекаются. Прибытия позже max_time тоже отсекаются
+    Rounds Scan(size_t source, std::optional<size_t> target, Weight max_time) const{
+        const size_t stop_count = stops_.size();
+
+        // arrivals[k][s] - лучшее прибытие на s не более чем с k посадками,
+        // labels[k][s] - поездка, которой это прибытие улучшено в раунде k
+        std::vector<std::vector<Weight>> arrivals{std::vector<Weight>(stop_count, INFINITE_TIME)};
+        std::vector<std::vector<std::optional<Label>>> labels{std::vector<std::optional<Label>>(stop_count)};
+        std::vector<Weight> best_arrivals(stop_count, INFINITE_TIME);
+        arrivals[0][source] = ZERO_TIME;
+        best_arrivals[source] = ZERO_TIME;
+
+        std::vector<size_t> marked_stops{source};
+        std::vector<bool> is_marked(stop_count, false);
+        // Для каждого маршрута - самая ранняя позиция отмеченной остановки
+        std::vector<std::optional<size_t>> route_start(routes_.size());
+        std::vector<size_t> queued_routes;
+
+        while(!marked_stops.empty()){
+            const std::vector<Weight>& prev_arrivals = arrivals.back();
+            std::vector<Weight> round_arrivals = prev_arrivals;
+            std::vector<std::optional<Label>> round_labels(stop_count);
+
+            for(size_t stop : marked_stops){
+                is_marked[stop] = false;
+                for(const auto& [route_index, pos] : stop_routes_[stop]){
+                    auto& start = route_start[route_index];
+                    if(!start){
+                        queued_routes.push_back(route_index);
+                    }
+                    if(!start || pos < *start){
+                        start = pos;
+                    }
+                }
+            }
+            marked_stops.clear();
+
+            for(size_t route_index : queued_routes){
+                const Route& route = routes_[route_index];
+                // Позиция посадки и время в момент отправления с нее
+                std::optional<size_t> board_pos;
+                Weight board_time{};
+                for(size_t pos = *route_start[route_index]; pos < route.stops.size(); ++pos){
+                    const size_t stop = route.stops[pos];
+                    if(board_pos){
+                        const Weight arrival = board_time + GetRideTime(route, *board_pos, pos);
+                        // Отсечение по лучшему известному прибытию на цель
+                        if(arrival < best_arrivals[stop] && !(max_time < arrival)
+                           && (!target || arrival < best_arrivals[*target])){
+                            round_arrivals[stop] = arrival;
+                            best_arrivals[stop] = arrival;
+                            round_labels[stop] = Label{route_index, *board_pos, pos};
+                            if(!is_marked[stop]){
+                                is_marked[stop] = true;
+                                marked_stops.push_back(stop);
+                            }
+                        }
+                    }
+                    // Пересесть на этот автобус здесь выгоднее, чем ехать на нем с прежней посадки
+                    if(prev_arrivals[stop] != INFINITE_TIME){
+                        const Weight departure = prev_arrivals[stop] + wait_time_;
+                        if(!board_pos
+                           || departure < board_time + GetRideTime(route, *board_pos, pos)){
+                            board_pos = pos;
+                            board_time = departure;
+                        }
+                    }
+                }
+                route_start[route_index].reset();
+            }
+            queued_routes.clear();
+
+            arrivals.push_back(std::move(round_arrivals));
+            labels.push_back(std::move(round_labels));
+        }
+
+        return {std::move(labels), std::move(best_arrivals)};
+    }
+
+    Weight GetRideTime(const Route& route, size_t board_pos, size_t alight_pos) const{
+        const double time = (route.distances[alight_pos] - route.distances[board_pos]) / velocity_;
+        if constexpr(std::is_integral_v<Weight>){
+            return static_cast<Weight>(std::llround(time));
+        } else {
+            return time;
+        }
+    }
+
+    // Восстанавливает поездки от цели к началу. Посадка в раунде k
+    // опирается на прибытие, улучшенное в последнем раунде до k
+    std::vector<Leg> RestoreLegs(const std::vector<std::vector<std::optional<Label>>>& labels,
+                                 size_t source, size_t target) const{
+        std::vector<Leg> legs;
+        size_t stop = target;
+        size_t round = labels.size();
+        while(stop != source){
+            do{
+                if(round == 0){
+                    throw std::logic_error("Broken RAPTOR labels");
+                }
+                --round;
+            } while(!labels[round][stop]);
+
+            const Label& label = *labels[round][stop];
+            const Route& route = routes_[label.route_index];
+            legs.push_back({stops_[route.stops[label.board_pos]], route.bus,
+                            static_cast<int>(label.alight_pos - label.board_pos),
+                            GetRideTime(route, label.board_pos, label.alight_pos)});
+            stop = route.stops[label.board_pos];
+        }
+        std::reverse(legs.begin(), legs.end());
+        return legs;
+    }
+
+    Weight wait_time_;
+    double velocity_;
+    // Остановки по номеру в каталоге
+    std::vector<const Stop*> stops_;
+    std::vector<Route> routes_;
+    // Для каждой остановки - все маршруты и позиции в них, где она встречается
+    std::vector<std::vector<RouteStop>> stop_routes_;
+};
+
+} // namespace transport_router
+
+} // namespace transport_catalogue
\ No newline at end of file
@@ -23,7 +23,21 @@ void RequestHandler::AddRenderSettings(map_render::RenderSettings&& settings){
 }
 
 void RequestHandler::AddRoutingSettings(transport_router::RoutingSettings&& settings){
+    route_weights_ = settings.weights_;
     router_.SetSettings(settings);
+    fixed_router_.SetSettings(settings);
+}
+
+void RequestHandler::AddSerializationSettings(serialization::SerializationSettings&& settings){
+    serialization_settings_ = std::move(settings);
+}
+
+void RequestHandler::SetStatThreadCount(size_t thread_count){
+    stat_thread_count_ = thread_count;
+}
+
+void RequestHandler::SetRouterWarmUp(bool is_warm_up){
+    is_router_warm_up_ = is_warm_up;
 }
 
 
@@ -58,54 +72,166 @@ void RequestHandler::ApplyBusRequests(TransportCatalogue& catalogue){
     }
 }
 
-void RequestHandler::ApplyStatRequests(TransportCatalogue& catalogue){
-    for(MultiStatRequest& req : stat_requests_){
-        if(req.IsRequestGetInfo()){
-            RequestGetInfo info_req = req.AsRequestGetInfo();
-                if(info_req.type_ == "Stop"){
-                StopInfo stop_info = catalogue.GetStopInfo(info_req.name_);
-                if(stop_info.is_find){
-                    ResponseStopInfo response(info_req.id_, stop_info.buses);
-                    responses_.emplace_back(response);
-                } else {
-                    ResponseError response(info_req.id_);
-                    responses_.emplace_back(response);
-                }
-            } else if(info_req.type_ == "Bus"){
-                BusInfo bus_info = catalogue.GetBusInfo(info_req.name_);
-                if(bus_info.is_find){
-                    ResponseBusInfo response(info_req.id_,bus_info.curvature,bus_info.route_length,
-                    bus_info.stop_count,bus_info.unique_stops);
-                    responses_.emplace_back(response);
-                } else {
-                    ResponseError response(info_req.id_);
-                    responses_.emplace_back(response);
-                }
+MultiResponse RequestHandler::ApplyStatRequest(const TransportCatalogue& catalogue, MultiStatRequest& req){
+    if(req.IsRequestGetInfo()){
+        RequestGetInfo info_req = req.AsRequestGetInfo();
+        if(info_req.type_ == "Stop"){
+            StopInfo stop_info = catalogue.GetStopInfo(info_req.name_);
+            if(stop_info.is_find){
+                return ResponseStopInfo(info_req.id_, stop_info.buses);
             }
-        } else if(req.IsRequestGetMap()){
-            RequestGetMap map_req = req.AsRequestGetMap();
-            // Отправляем запрос
-             // на получение маршрутов
-            std::map<std::string_view, const Bus*> buses = std::move(catalogue.GetSortedBuses());
-            ResponseMap response(map_req.id_, map_render_.Render(buses));
-            responses_.emplace_back(response);
-        } else if(req.IsRequestGetRoute()){
-            RequestGetRoute route_req = req.AsRequestGetRoute();
-            if(!router_.IsCreated()){
-                router_.CreateGraph(catalogue);
+        } else if(info_req.type_ == "Bus"){
+            BusInfo bus_info = catalogue.GetBusInfo(info_req.name_);
+            if(bus_info.is_find){
+                return ResponseBusInfo(info_req.id_,bus_info.curvature,bus_info.route_length,
+                bus_info.stop_count,bus_info.unique_stops);
             }
-            auto route_info = router_.BuildRoute(route_req.from_, route_req.to_);
-            if(route_info.has_value()){
-                ResponseRoute response(route_req.id_, (*route_info).total_weight_, std::move((*route_info).items_));
-                responses_.emplace_back(response);
-            } else {
-                ResponseError response(route_req.id_);
-                responses_.emplace_back(response);
+        }
+        return ResponseError(info_req.id_);
+    } else if(req.IsRequestGetMap()){
+        RequestGetMap map_req = req.AsRequestGetMap();
+        // Отправляем запрос
+         // на получение маршрутов
+        std::map<std::string_view, const Bus*> buses = catalogue.GetSortedBuses();
+        return ResponseMap(map_req.id_, map_render_.Render(buses));
+    } else if(route_weights_ == transport_router::RouteWeights::FIXED_POINT){
+        return ApplyRoutingRequest(fixed_router_, req);
+    } else {
+        return ApplyRoutingRequest(router_, req);
+    }
+}
+
+template<typename Weight>
+MultiResponse RequestHandler::ApplyRoutingRequest(transport_router::TransportRouter<Weight>& router,
+                                                  MultiStatRequest& req){
+    using Units = typename transport_router::TransportRouter<Weight>::Units;
+    // Для вещественных весов ответ берет результат маршрутизатора как есть,
+    // целые веса переводятся в минуты
+    constexpr bool is_minutes = std::is_same_v<Weight, double>;
+
+    if(req.IsRequestGetRoute()){
+        RequestGetRoute route_req = req.AsRequestGetRoute();
+        auto route_info = router.BuildRoute(route_req.from_, route_req.to_, route_req.profile_);
+        if(!route_info.has_value()){
+            return ResponseError(route_req.id_);
+        }
+        const double total_time = Units::ToMinutes((*route_info).total_weight_);
+        if constexpr(is_minutes){
+            return ResponseRoute(route_req.id_, total_time, std::move((*route_info).items_));
+        } else {
+            std::vector<RouteItem> items;
+            items.reserve((*route_info).items_.size());
+            for(const auto& item : (*route_info).items_){
+                items.push_back({item.type_, Units::ToMinutes(item.time_), item.name_, item.span_count_});
             }
+            return ResponseRoute(route_req.id_, total_time, std::move(items));
+        }
+    } else if(req.IsRequestGetRouteMatrix()){
+        const RequestGetRouteMatrix& matrix_req = req.AsRequestGetRouteMatrix();
+        auto matrix = router.BuildRouteMatrix(matrix_req.from_, matrix_req.to_, matrix_req.profile_);
+        if(!matrix.has_value()){
+            return ResponseError(matrix_req.id_);
+        }
+        if constexpr(is_minutes){
+            return ResponseRouteMatrix(matrix_req.id_, std::move(*matrix));
+        } else {
+            RouteMatrix total_times;
+            total_times.reserve((*matrix).size());
+            for(const auto& row : *matrix){
+                auto& total_times_row = total_times.emplace_back();
+                total_times_row.reserve(row.size());
+                for(const auto& weight : row){
+                    total_times_row.push_back(weight ? std::optional<double>(Units::ToMinutes(*weight)) : std::nullopt);
+                }
+            }
+            return ResponseRouteMatrix(matrix_req.id_, std::move(total_times));
+        }
+    } else {
+        const RequestGetReachable& reachable_req = req.AsRequestGetReachable();
+        // Целые веса не представляют отрицательное время: поиск идет с нулем, чтобы
+        // проверить остановку, а ответ пустой - за отрицательное время никуда не попасть
+        const bool is_negative_time = reachable_req.max_time_ < 0;
+        auto stops = router.BuildReachable(reachable_req.from_, Units::FromMinutes(std::max(reachable_req.max_time_, 0.0)),
+                                           reachable_req.profile_);
+        if(!stops.has_value()){
+            return ResponseError(reachable_req.id_);
+        }
+        if(is_negative_time){
+            (*stops).clear();
+        }
+        if constexpr(is_minutes){
+            return ResponseReachable(reachable_req.id_, std::move(*stops));
+        } else {
+            ReachableStops reachable_stops;
+            reachable_stops.reserve((*stops).size());
+            for(const auto& [stop_name, time] : *stops){
+                reachable_stops.emplace_back(stop_name, Units::ToMinutes(time));
+            }
+            return ResponseReachable(reachable_req.id_, std::move(reachable_stops));
+        }
+    }
+}
+
+void RequestHandler::CreateRouter(const TransportCatalogue& catalogue){
+    if(route_weights_ == transport_router::RouteWeights::FIXED_POINT){
+        if(!fixed_router_.IsCreated()){
+            fixed_router_.CreateGraph(catalogue);
         }
+    } else if(!router_.IsCreated()){
+        router_.CreateGraph(catalogue);
     }
 }
 
+bool RequestHandler::IsRoutingRequest(MultiStatRequest& req){
+    return req.IsRequestGetRoute() || req.IsRequestGetRouteMatrix() || req.IsRequestGetReachable();
+}
+
+void RequestHandler::ApplyStatRequests(TransportCatalogue& catalogue){
+    // Маршрутизатор строится один раз до первого запроса к нему,
+    // дальше запросы только читают каталог и маршрутизатор
+    const size_t first_routing = std::find_if(stat_requests_.begin(), stat_requests_.end(), IsRoutingRequest)
+                                 - stat_requests_.begin();
+
+    // Каждый ответ записывается на место своего запроса,
+    // поэтому порядок ответов не зависит от числа потоков
+    std::vector<std::optional<MultiResponse>> responses(stat_requests_.size());
+    size_t begin = 0;
+    if(router_warm_up_.valid()){
+        // Пока маршрутизатор строится в фоне, отвечаем на запросы до первого
+        // запроса к нему. Ошибка построения передается отсюда
+        ApplyStatRequestRange(catalogue, 0, first_routing, responses);
+        begin = first_routing;
+        router_warm_up_.get();
+    } else if(first_routing < stat_requests_.size()){
+        CreateRouter(catalogue);
+    }
+    ApplyStatRequestRange(catalogue, begin, stat_requests_.size(), responses);
+
+    responses_.reserve(responses_.size() + responses.size());
+    for(std::optional<MultiResponse>& response : responses){
+        responses_.push_back(std::move(*response));
+    }
+}
+
+void RequestHandler::ApplyStatRequestRange(const TransportCatalogue& catalogue, size_t begin, size_t end,
+                                           std::vector<std::optional<MultiResponse>>& responses){
+    const size_t chunk_count = (end - begin + STAT_REQUESTS_CHUNK_SIZE - 1) / STAT_REQUESTS_CHUNK_SIZE;
+    graph::ParallelFor(chunk_count, GetStatThreadCount(), [&](size_t chunk){
+        const size_t chunk_begin = begin + chunk * STAT_REQUESTS_CHUNK_SIZE;
+        const size_t chunk_end = std::min(chunk_begin + STAT_REQUESTS_CHUNK_SIZE, end);
+        for(size_t i = chunk_begin; i < chunk_end; ++i){
+            responses[i] = ApplyStatRequest(catalogue, stat_requests_[i]);
+        }
+    });
+}
+
+size_t RequestHandler::GetStatThreadCount() const{
+    if(stat_thread_count_ != 0){
+        return stat_thread_count_;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
 void RequestHandler::ApplyRequests(TransportCatalogue& catalogue){
     // Сначала добавляем остановки
     // параллельно записывая
@@ -114,12 +240,43 @@ void RequestHandler::ApplyRequests(TransportCatalogue& catalogue){
     
     // Добавляем маршруты
     ApplyBusRequests(catalogue);
+    catalogue.FreezeNames();
+
+    // Каталог больше не меняется, маршрутизатор
+    // можно строить в фоне, если он понадобится
+    if(is_router_warm_up_ && std::any_of(stat_requests_.begin(), stat_requests_.end(), IsRoutingRequest)){
+        router_warm_up_ = std::async(std::launch::async, [this, &catalogue]{
+            CreateRouter(catalogue);
+        });
+    }
 
     // Отправляем запросы 
     // на получение данных из базы
     ApplyStatRequests(catalogue);
 }
 
+void RequestHandler::MakeBase(TransportCatalogue& catalogue){
+    ApplyStopRequests(catalogue);
+    ApplyBusRequests(catalogue);
+
+    // Маршрутизатор строится сразу, чтобы
+    // process_requests не тратил на это время
+    CreateRouter(catalogue);
+    serialization::SaveBase(serialization_settings_, catalogue, map_render_.GetSettings(), router_, fixed_router_);
+}
+
+void RequestHandler::ProcessRequests(TransportCatalogue& catalogue){
+    map_render::RenderSettings render_settings;
+    serialization::LoadBase(serialization_settings_, catalogue, render_settings, router_, fixed_router_);
+    map_render_.SetSettings(render_settings);
+    catalogue.FreezeNames();
+    // Тип весов определяется сохраненным маршрутизатором
+    route_weights_ = fixed_router_.IsCreated() ? transport_router::RouteWeights::FIXED_POINT
+                                               : transport_router::RouteWeights::MINUTES;
+
+    ApplyStatRequests(catalogue);
+}
+
 std::vector<MultiResponse>& RequestHandler::GetResponses(){
     return responses_;
 }
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <future>
 #include <variant>
 #include <sstream>
 #include <map>
+#include <optional>
+#include <thread>
 #include "transport_catalogue.h"
 #include "map_renderer.h"
 #include "transport_router.h"
+#include "serialization.h"
 
 namespace transport_catalogue{
 
@@ -15,7 +20,8 @@ namespace detail{
 
 using Distances = std::unordered_map<std::string, int>;
 using Stops = std::vector<std::string>;
-using Buses = std::set<std::string>;
+// Названия маршрутов ссылаются на строки каталога
+using Buses = std::vector<std::string_view>;
 using BusLocation = std::vector<std::pair<double, double>>;
 
 //Requests
@@ -77,16 +83,39 @@ struct RequestGetMap{
 };
 
 struct RequestGetRoute{
-    RequestGetRoute(std::string from, std::string to, int id)
-    :from_(from), to_(to), id_(id){}
+    RequestGetRoute(std::string from, std::string to, int id, std::string profile = {})
+    :from_(from), to_(to), id_(id), profile_(std::move(profile)){}
 
     std::string from_;
     std::string to_;
     int id_ = 0;
+    // Профиль маршрутизации, пустой - основной
+    std::string profile_;
 
 };
 
-class MultiStatRequest : private std::variant<RequestGetInfo, RequestGetMap, RequestGetRoute>{
+struct RequestGetRouteMatrix{
+    RequestGetRouteMatrix(std::vector<std::string> from, std::vector<std::string> to, int id, std::string profile = {})
+    :from_(std::move(from)), to_(std::move(to)), id_(id), profile_(std::move(profile)){}
+
+    std::vector<std::string> from_;
+    std::vector<std::string> to_;
+    int id_ = 0;
+    std::string profile_;
+};
+
+struct RequestGetReachable{
+    RequestGetReachable(std::string from, double max_time, int id, std::string profile = {})
+    :from_(std::move(from)), max_time_(max_time), id_(id), profile_(std::move(profile)){}
+
+    std::string from_;
+    double max_time_ = 0;
+    int id_ = 0;
+    std::string profile_;
+};
+
+class MultiStatRequest : private std::variant<RequestGetInfo, RequestGetMap, RequestGetRoute, RequestGetRouteMatrix,
+                                              RequestGetReachable>{
 public:
     using variant::variant;
 
@@ -113,6 +142,22 @@ public:
     RequestGetRoute AsRequestGetRoute(){
         return std::get<RequestGetRoute>(*this);
     }
+
+    bool IsRequestGetRouteMatrix(){
+        return std::holds_alternative<RequestGetRouteMatrix>(*this);
+    }
+
+    const RequestGetRouteMatrix& AsRequestGetRouteMatrix(){
+        return std::get<RequestGetRouteMatrix>(*this);
+    }
+
+    bool IsRequestGetReachable(){
+        return std::holds_alternative<RequestGetReachable>(*this);
+    }
+
+    const RequestGetReachable& AsRequestGetReachable(){
+        return std::get<RequestGetReachable>(*this);
+    }
 };
 
 //Responses
@@ -135,7 +180,7 @@ struct ResponseBusInfo : public BaseResponse{
 
 struct ResponseStopInfo : public BaseResponse{
     ResponseStopInfo(int request_id, Buses buses)
-    :BaseResponse(request_id), buses_(buses){}
+    :BaseResponse(request_id), buses_(std::move(buses)){}
 
     Buses buses_;
 };
@@ -154,22 +199,41 @@ struct ResponseMap : BaseResponse{
     std::string map_;
 };
 
-using BaseEdgePtr = typename std::shared_ptr<transport_router::TransportRouter<double>::BaseEdge>;
-using WaitEdgePtr = typename transport_router::TransportRouter<double>::WaitEdge*;
-using BusEdgePtr = typename transport_router::TransportRouter<double>::BusEdge*;
+using RouteItem = transport_router::TransportRouter<double>::RouteItem;
 
 
 struct ResponseRoute : BaseResponse{
-    ResponseRoute(int request_id, double total_time, std::vector<BaseEdgePtr> items)
+    ResponseRoute(int request_id, double total_time, std::vector<RouteItem> items)
     : BaseResponse(request_id), total_time_(total_time), items_(std::move(items)){
 
     }
 
     double total_time_ = 0;
-    std::vector<BaseEdgePtr> items_;
+    std::vector<RouteItem> items_;
 };
 
-class MultiResponse : private std::variant<ResponseBusInfo, ResponseStopInfo, ResponseError, ResponseMap, ResponseRoute>{
+using RouteMatrix = transport_router::TransportRouter<double>::WeightMatrix;
+
+// Только время в пути для каждой пары остановок, без описания маршрутов
+struct ResponseRouteMatrix : BaseResponse{
+    ResponseRouteMatrix(int request_id, RouteMatrix total_times)
+    : BaseResponse(request_id), total_times_(std::move(total_times)){}
+
+    RouteMatrix total_times_;
+};
+
+using ReachableStops = transport_router::TransportRouter<double>::ReachableStops;
+
+// Остановки, достижимые за заданное время, и время в пути до них
+struct ResponseReachable : BaseResponse{
+    ResponseReachable(int request_id, ReachableStops stops)
+    : BaseResponse(request_id), stops_(std::move(stops)){}
+
+    ReachableStops stops_;
+};
+
+class MultiResponse : private std::variant<ResponseBusInfo, ResponseStopInfo, ResponseError, ResponseMap, ResponseRoute,
+                                           ResponseRouteMatrix, ResponseReachable>{
 public:
     using variant::variant;
 
@@ -212,6 +276,22 @@ public:
     ResponseRoute AsResponseRoute(){
         return std::get<ResponseRoute>(*this);
     }
+
+    bool IsResponseRouteMatrix(){
+        return std::holds_alternative<ResponseRouteMatrix>(*this);
+    }
+
+    const ResponseRouteMatrix& AsResponseRouteMatrix(){
+        return std::get<ResponseRouteMatrix>(*this);
+    }
+
+    bool IsResponseReachable(){
+        return std::holds_alternative<ResponseReachable>(*this);
+    }
+
+    const ResponseReachable& AsResponseReachable(){
+        return std::get<ResponseReachable>(*this);
+    }
 };
 
 } // namespace detail
@@ -222,19 +302,55 @@ public:
     void AddStatRequest(detail::MultiStatRequest&& request);
     void AddRenderSettings(map_render::RenderSettings&& settings);
     void AddRoutingSettings(transport_router::RoutingSettings&& settings);
+    void AddSerializationSettings(serialization::SerializationSettings&& settings);
+    // Число потоков для ответов на stat_requests, 0 - по числу ядер
+    void SetStatThreadCount(size_t thread_count);
+    // Строить маршрутизатор в фоне сразу после добавления маршрутов,
+    // пока отвечаем на запросы до первого запроса к маршрутизатору
+    void SetRouterWarmUp(bool is_warm_up);
 
     void ApplyRequests(TransportCatalogue& catalogue);
+    // Наполняет каталог, строит маршрутизатор и сохраняет все в файл базы
+    void MakeBase(TransportCatalogue& catalogue);
+    // Загружает каталог и маршрутизатор из файла базы и отвечает на stat_requests
+    void ProcessRequests(TransportCatalogue& catalogue);
     std::vector<detail::MultiResponse>& GetResponses();
 private:
     void ApplyStopRequests(TransportCatalogue& catalogue);
     void ApplyBusRequests(TransportCatalogue& catalogue);
     void ApplyStatRequests(TransportCatalogue& catalogue);
+    // Отвечает на запросы [begin, end) на нескольких потоках, ответы записываются на места запросов
+    void ApplyStatRequestRange(const TransportCatalogue& catalogue, size_t begin, size_t end,
+                               std::vector<std::optional<detail::MultiResponse>>& responses);
+    // Запрос к маршрутизатору: Route, RouteMatrix или Reachable
+    static bool IsRoutingRequest(detail::MultiStatRequest& req);
+    // Ответ на один запрос. Только читает каталог и построенный
+    // маршрутизатор, поэтому вызывается из нескольких потоков
+    detail::MultiResponse ApplyStatRequest(const TransportCatalogue& catalogue, detail::MultiStatRequest& req);
+    // Ответ на запрос к маршрутизатору с весами Weight, время в ответе - в минутах
+    template<typename Weight>
+    detail::MultiResponse ApplyRoutingRequest(transport_router::TransportRouter<Weight>& router,
+                                              detail::MultiStatRequest& req);
+    // Строит маршрутизатор с весами из настроек, если он еще не построен
+    void CreateRouter(const TransportCatalogue& catalogue);
+    size_t GetStatThreadCount() const;
+
+    // Столько подряд идущих запросов обрабатывает поток за раз
+    static constexpr size_t STAT_REQUESTS_CHUNK_SIZE = 16;
 
     std::map<std::string, std::vector<detail::MultiBaseRequest>> base_requests_;
     std::vector<detail::MultiStatRequest> stat_requests_;
     std::vector<detail::MultiResponse> responses_;
     map_render::MapRender map_render_;
     transport_router::TransportRouter<double> router_;
+    // Используется вместо router_, если в настройках заданы веса с фиксированной точкой
+    transport_router::TransportRouter<uint32_t> fixed_router_;
+    transport_router::RouteWeights route_weights_ = transport_router::RouteWeights::MINUTES;
+    serialization::SerializationSettings serialization_settings_;
+    size_t stat_thread_count_ = 1;
+    bool is_router_warm_up_ = false;
+    // Построение маршрутизатора в фоне, действительно до первого запроса к нему
+    std::future<void> router_warm_up_;
 };
 
 } // namespace request_handler
@@ -3,72 +3,319 @@
 #include "graph.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
+#include <exception>
 #include <iterator>
+#include <functional>
+#include <limits>
+#include <mutex>
 #include <optional>
+#include <queue>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// Результат поиска пути, общий для всех движков маршрутизации
 template <typename Weight>
-class Router {
-private:
-    using Graph = DirectedWeightedGraph<Weight>;
+struct RouteInfo {
+    Weight weight;
+    std::vector<EdgeId> edges;
+};
+
+// Веса кратчайших путей от каждой начальной вершины до каждой конечной,
+// std::nullopt - пути нет
+template <typename Weight>
+using WeightMatrix = std::vector<std::vector<std::optional<Weight>>>;
+
+// Вершина, достижимая из начальной, и вес кратчайшего пути до нее
+template <typename Weight>
+struct ReachedVertex {
+    VertexId vertex;
+    Weight weight;
+};
 
+// Таблица маршрутов Router по умолчанию: вложенные векторы optional
+// с весом пути и последним ребром, около 32 байт на пару вершин
+template <typename Weight>
+class NestedRouteStorage {
 public:
-    explicit Router(Graph graph);
+    // Вес в таблице хранится без потерь
+    static constexpr bool IS_EXACT = true;
+    static constexpr size_t MAX_EDGE_COUNT = std::numeric_limits<EdgeId>::max();
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    explicit NestedRouteStorage(size_t vertex_count)
+        : routes_(vertex_count, std::vector<std::optional<RouteInternalData>>(vertex_count)) {
+    }
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    bool HasRoute(VertexId from, VertexId to) const {
+        return routes_[from][to].has_value();
+    }
+
+    Weight GetWeight(VertexId from, VertexId to) const {
+        return routes_[from][to]->weight;
+    }
+
+    // Последнее ребро пути, nullopt для пути из вершины в саму себя
+    std::optional<EdgeId> GetPrevEdge(VertexId from, VertexId to) const {
+        return routes_[from][to]->prev_edge;
+    }
+
+    void SetRoute(VertexId from, VertexId to, Weight weight, std::optional<EdgeId> prev_edge) {
+        routes_[from][to] = RouteInternalData{weight, prev_edge};
+    }
+
+    size_t GetVertexCount() const {
+        return routes_.size();
+    }
+
+    // Примерный объем памяти таблицы в байтах
+    static size_t EstimateMemory(size_t vertex_count) {
+        return vertex_count * (sizeof(routes_[0]) + vertex_count * sizeof(routes_[0][0]));
+    }
+
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        writer.template Write<uint64_t>(routes_.size());
+        for (const auto& row : routes_) {
+            for (const auto& route : row) {
+                writer.Write(route.has_value());
+                if (route) {
+                    writer.Write(route->weight);
+                    writer.Write(route->prev_edge.has_value());
+                    writer.Write(route->prev_edge.value_or(0));
+                }
+            }
+        }
+    }
+
+    template <typename Reader>
+    static NestedRouteStorage Load(Reader& reader) {
+        NestedRouteStorage storage(reader.template Read<uint64_t>());
+        for (auto& row : storage.routes_) {
+            for (auto& route : row) {
+                if (!reader.template Read<bool>()) {
+                    continue;
+                }
+                const Weight weight = reader.template Read<Weight>();
+                const bool has_prev_edge = reader.template Read<bool>();
+                const EdgeId prev_edge = reader.template Read<EdgeId>();
+                route = RouteInternalData{weight, has_prev_edge ? std::optional<EdgeId>(prev_edge) : std::nullopt};
+            }
+        }
+        return storage;
+    }
 
 private:
     struct RouteInternalData {
         Weight weight;
         std::optional<EdgeId> prev_edge;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
+    std::vector<std::vector<std::optional<RouteInternalData>>> routes_;
+};
+
+// Компактная таблица маршрутов Router: один плоский массив по строкам,
+// вес в StoredWeight (float или целое с фиксированной точкой 1/FIXED_POINT_SCALE)
+// и 32-битное последнее ребро. Отсутствие пути и ребра кодируется
+// значениями-стражами, пара вершин занимает 8 байт вместо ~32
+template <typename Weight, typename StoredWeight = float>
+class CompactRouteStorage {
+private:
+    static constexpr StoredWeight NO_ROUTE = std::numeric_limits<StoredWeight>::max();
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+
+public:
+    // Вес хранится с потерей точности, поэтому Router пересчитывает
+    // вес найденного пути по исходным ребрам
+    static constexpr bool IS_EXACT = false;
+    static constexpr size_t MAX_EDGE_COUNT = NO_EDGE;
+    static constexpr double FIXED_POINT_SCALE = 1000;
+
+    explicit CompactRouteStorage(size_t vertex_count)
+        : vertex_count_(vertex_count)
+        , cells_(vertex_count * vertex_count, Cell{NO_ROUTE, NO_EDGE}) {
+    }
+
+    bool HasRoute(VertexId from, VertexId to) const {
+        return cells_[from * vertex_count_ + to].weight != NO_ROUTE;
+    }
+
+    Weight GetWeight(VertexId from, VertexId to) const {
+        return ToWeight(cells_[from * vertex_count_ + to].weight);
+    }
+
+    std::optional<EdgeId> GetPrevEdge(VertexId from, VertexId to) const {
+        const uint32_t prev_edge = cells_[from * vertex_count_ + to].prev_edge;
+        if (prev_edge == NO_EDGE) {
+            return std::nullopt;
+        }
+        return prev_edge;
+    }
+
+    void SetRoute(VertexId from, VertexId to, Weight weight, std::optional<EdgeId> prev_edge) {
+        cells_[from * vertex_count_ + to] = {FromWeight(weight),
+                                             prev_edge ? static_cast<uint32_t>(*prev_edge) : NO_EDGE};
+    }
+
+    size_t GetVertexCount() const {
+        return vertex_count_;
+    }
+
+    static size_t EstimateMemory(size_t vertex_count) {
+        return vertex_count * vertex_count * sizeof(Cell);
+    }
+
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        writer.template Write<uint64_t>(vertex_count_);
+        writer.WriteVector(cells_);
+    }
+
+    template <typename Reader>
+    static CompactRouteStorage Load(Reader& reader) {
+        CompactRouteStorage storage(0);
+        storage.vertex_count_ = reader.template Read<uint64_t>();
+        storage.cells_ = reader.template ReadVector<Cell>();
+        if (storage.cells_.size() != storage.vertex_count_ * storage.vertex_count_) {
+            throw std::runtime_error("Corrupted route table data");
+        }
+        return storage;
+    }
+
+private:
+    struct Cell {
+        StoredWeight weight;
+        uint32_t prev_edge;
+    };
+
+    static StoredWeight FromWeight(Weight weight) {
+        if constexpr (std::is_floating_point_v<StoredWeight>) {
+            return static_cast<StoredWeight>(weight);
+        } else {
+            const double scaled = std::round(static_cast<double>(weight) * FIXED_POINT_SCALE);
+            // Значение NO_ROUTE зарезервировано под отсутствие пути
+            return static_cast<StoredWeight>(std::min(scaled, static_cast<double>(NO_ROUTE - 1)));
+        }
+    }
+
+    static Weight ToWeight(StoredWeight weight) {
+        if constexpr (std::is_floating_point_v<StoredWeight>) {
+            return static_cast<Weight>(weight);
+        } else {
+            return static_cast<Weight>(weight / FIXED_POINT_SCALE);
+        }
+    }
+
+    size_t vertex_count_ = 0;
+    std::vector<Cell> cells_;
+};
+
+// Вычисляет кратчайшие пути между всеми парами вершин
+// (Флойд-Уоршелл) в конструкторе, запрос - O(длины пути).
+// Способ хранения таблицы задается параметром Storage
+template <typename Weight, typename Storage = NestedRouteStorage<Weight>>
+class Router {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    explicit Router(Graph graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Матрица весов берется из таблицы без восстановления путей
+    WeightMatrix<Weight> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+
+    // Вершины, путь до которых не тяжелее max_weight: просмотр строки таблицы
+    std::vector<ReachedVertex<Weight>> BuildReachable(VertexId from, Weight max_weight) const;
+
+    // Примерный объем памяти графа и таблицы в байтах, до построения
+    static size_t EstimateMemory(size_t vertex_count, size_t edge_count) {
+        return Graph::EstimateMemory(vertex_count, edge_count) + Storage::EstimateMemory(vertex_count);
+    }
+
+    // Сохраняет граф и готовую таблицу, загрузка не повторяет вычислений
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        graph_.Save(writer);
+        routes_internal_data_.Save(writer);
+    }
+
+    template <typename Reader>
+    static Router Load(Reader& reader) {
+        Graph graph = Graph::Load(reader);
+        return Router(std::move(graph), Storage::Load(reader));
+    }
+
+private:
+    Router(Graph graph, Storage routes_internal_data)
+        : graph_(std::move(graph))
+        , routes_internal_data_(std::move(routes_internal_data)) {
+    }
+
+    // Вес пути из таблицы. Вес в компактной таблице приближенный,
+    // поэтому точный вес считается как сумма весов ребер пути
+    Weight GetExactWeight(VertexId from, VertexId to) const {
+        if constexpr (Storage::IS_EXACT) {
+            return routes_internal_data_.GetWeight(from, to);
+        } else {
+            Weight weight = ZERO_WEIGHT;
+            for (std::optional<EdgeId> edge_id = routes_internal_data_.GetPrevEdge(from, to);
+                 edge_id;
+                 edge_id = routes_internal_data_.GetPrevEdge(from, graph_.GetEdge(*edge_id).from))
+            {
+                weight += graph_.GetEdge(*edge_id).weight;
+            }
+            return weight;
+        }
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
         for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+            routes_internal_data_.SetRoute(vertex, vertex, ZERO_WEIGHT, std::nullopt);
+            for (const auto& arc : graph.GetOutgoingArcs(vertex)) {
+                if (arc.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                if (!routes_internal_data_.HasRoute(vertex, arc.to)
+                    || routes_internal_data_.GetWeight(vertex, arc.to) > arc.weight) {
+                    routes_internal_data_.SetRoute(vertex, arc.to, arc.weight, arc.edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, Weight weight_from,
+                    std::optional<EdgeId> prev_edge_from, VertexId vertex_through) {
+        const Weight candidate_weight = weight_from + routes_internal_data_.GetWeight(vertex_through, vertex_to);
+        if (!routes_internal_data_.HasRoute(vertex_from, vertex_to)
+            || candidate_weight < routes_internal_data_.GetWeight(vertex_from, vertex_to)) {
+            const std::optional<EdgeId> prev_edge_to = routes_internal_data_.GetPrevEdge(vertex_through, vertex_to);
+            routes_internal_data_.SetRoute(vertex_from, vertex_to, candidate_weight,
+                                           prev_edge_to ? prev_edge_to : prev_edge_from);
         }
     }
 
     void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
         for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
+            if (routes_internal_data_.HasRoute(vertex_from, vertex_through)) {
+                const Weight weight_from = routes_internal_data_.GetWeight(vertex_from, vertex_through);
+                const std::optional<EdgeId> prev_edge_from = routes_internal_data_.GetPrevEdge(vertex_from,
+                                                                                               vertex_through);
                 for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+                    if (routes_internal_data_.HasRoute(vertex_through, vertex_to)) {
+                        RelaxRoute(vertex_from, vertex_to, weight_from, prev_edge_from, vertex_through);
                     }
                 }
             }
@@ -77,15 +324,17 @@ private:
 
     static constexpr Weight ZERO_WEIGHT{};
     Graph graph_;
-    RoutesInternalData routes_internal_data_;
+    Storage routes_internal_data_;
 };
 
-template <typename Weight>
-Router<Weight>::Router(Graph graph)
+template <typename Weight, typename Storage>
+Router<Weight, Storage>::Router(Graph graph)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , routes_internal_data_(graph.GetVertexCount())
 {
+    if (graph.GetEdgeCount() > Storage::MAX_EDGE_COUNT) {
+        throw std::length_error("Too many edges for the route storage");
+    }
     InitializeRoutesInternalData(graph);
 
     const size_t vertex_count = graph.GetVertexCount();
@@ -94,24 +343,1633 @@ Router<Weight>::Router(Graph graph)
     }
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+template <typename Weight, typename Storage>
+std::optional<typename Router<Weight, Storage>::RouteInfo> Router<Weight, Storage>::BuildRoute(VertexId from,
+                                                                                               VertexId to) const {
+    if (from >= routes_internal_data_.GetVertexCount() || to >= routes_internal_data_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (!routes_internal_data_.HasRoute(from, to)) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
+    for (std::optional<EdgeId> edge_id = routes_internal_data_.GetPrevEdge(from, to);
          edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+         edge_id = routes_internal_data_.GetPrevEdge(from, graph_.GetEdge(*edge_id).from))
     {
         edges.push_back(*edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
+    Weight weight = routes_internal_data_.GetWeight(from, to);
+    if constexpr (!Storage::IS_EXACT) {
+        weight = ZERO_WEIGHT;
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+    }
     return RouteInfo{weight, std::move(edges)};
 }
 
+template <typename Weight, typename Storage>
+WeightMatrix<Weight> Router<Weight, Storage>::BuildWeightMatrix(const std::vector<VertexId>& from,
+                                                                const std::vector<VertexId>& to) const {
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+    WeightMatrix<Weight> matrix(from.size(), std::vector<std::optional<Weight>>(to.size()));
+    for (size_t row = 0; row < from.size(); ++row) {
+        for (size_t column = 0; column < to.size(); ++column) {
+            if (from[row] >= vertex_count || to[column] >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            if (routes_internal_data_.HasRoute(from[row], to[column])) {
+                matrix[row][column] = GetExactWeight(from[row], to[column]);
+            }
+        }
+    }
+    return matrix;
+}
+
+template <typename Weight, typename Storage>
+std::vector<ReachedVertex<Weight>> Router<Weight, Storage>::BuildReachable(VertexId from, Weight max_weight) const {
+    const size_t vertex_count = routes_internal_data_.GetVertexCount();
+    if (from >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    std::vector<ReachedVertex<Weight>> result;
+    for (VertexId to = 0; to < vertex_count; ++to) {
+        if (routes_internal_data_.HasRoute(from, to)) {
+            const Weight weight = GetExactWeight(from, to);
+            if (!(max_weight < weight)) {
+                result.push_back({to, weight});
+            }
+        }
+    }
+    return result;
+}
+
+// Вызывает func(index) для каждого index из [0, count) на thread_count потоках.
+// Индексы раздаются динамически, текущий поток тоже участвует в работе.
+// Первое исключение из func останавливает раздачу индексов и пробрасывается после join
+template <typename Func>
+void ParallelFor(size_t count, size_t thread_count, const Func& func) {
+    const size_t worker_count = std::min(std::max<size_t>(thread_count, 1), count);
+    if (worker_count <= 1) {
+        for (size_t index = 0; index < count; ++index) {
+            func(index);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const auto worker = [&]() {
+        try {
+            for (size_t index = next_index++; index < count; index = next_index++) {
+                func(index);
+            }
+        } catch (...) {
+            next_index = count;
+            std::lock_guard guard(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(worker_count - 1);
+    for (size_t i = 1; i < worker_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+namespace detail {
+
+// Вершина в очереди с приоритетом: текущая оценка расстояния до нее
+template <typename Weight>
+struct QueueItem {
+    Weight weight;
+    VertexId vertex;
+
+    bool operator>(const QueueItem& other) const {
+        return weight > other.weight;
+    }
+};
+
+template <typename Weight>
+using MinQueue = std::priority_queue<QueueItem<Weight>, std::vector<QueueItem<Weight>>,
+                                     std::greater<QueueItem<Weight>>>;
+
+// Очередь для целых беззнаковых весов, когда извлекаемые веса не убывают, как в Дейкстре.
+// Элемент лежит в корзине по номеру старшего бита, которым его вес отличается от последнего
+// извлеченного. Корзина 0 - веса, равные последнему извлеченному. Каждый элемент
+// перекладывается в корзину с меньшим номером, то есть не больше чем битность веса раз
+template <typename Weight>
+class RadixHeap {
+public:
+    static_assert(std::is_integral_v<Weight> && std::is_unsigned_v<Weight>,
+                  "Radix heap requires unsigned integer weights");
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    // Вес не должен быть меньше последнего извлеченного
+    void push(const QueueItem<Weight>& item) {
+        assert(!(item.weight < last_weight_));
+        buckets_[GetBucket(item.weight)].push_back(item);
+        ++size_;
+    }
+
+    const QueueItem<Weight>& top() {
+        Refill();
+        return buckets_[0].back();
+    }
+
+    void pop() {
+        Refill();
+        buckets_[0].pop_back();
+        --size_;
+    }
+
+private:
+    static constexpr size_t BUCKET_COUNT = std::numeric_limits<Weight>::digits + 1;
+
+    size_t GetBucket(Weight weight) const {
+        // Номер старшего отличающегося бита, считая с 1
+        Weight diff = weight ^ last_weight_;
+        size_t bucket = 0;
+        for (size_t shift = std::numeric_limits<Weight>::digits / 2; shift > 0; shift /= 2) {
+            if (diff >> shift) {
+                diff >>= shift;
+                bucket += shift;
+            }
+        }
+        return bucket + diff;
+    }
+
+    // Если корзина 0 пуста, минимальный вес первой непустой корзины становится
+    // последним извлеченным, и ее элементы раскладываются по младшим корзинам
+    void Refill() {
+        if (!buckets_[0].empty()) {
+            return;
+        }
+        size_t index = 1;
+        while (buckets_[index].empty()) {
+            ++index;
+        }
+        std::vector<QueueItem<Weight>>& bucket = buckets_[index];
+        last_weight_ = std::min_element(bucket.begin(), bucket.end(), [](const auto& lhs, const auto& rhs) {
+                           return lhs.weight < rhs.weight;
+                       })->weight;
+        for (const QueueItem<Weight>& item : bucket) {
+            buckets_[GetBucket(item.weight)].push_back(item);
+        }
+        bucket.clear();
+    }
+
+    std::vector<QueueItem<Weight>> buckets_[BUCKET_COUNT];
+    Weight last_weight_{};
+    size_t size_ = 0;
+};
+
+// Очередь для поисков с неубывающими извлекаемыми весами:
+// корзинная для целых весов, двоичная куча для остальных
+template <typename Weight>
+using MonotoneQueue = std::conditional_t<std::is_integral_v<Weight> && std::is_unsigned_v<Weight>,
+                                         RadixHeap<Weight>, MinQueue<Weight>>;
+
+}  // namespace detail
+
+// Те же пути между всеми парами вершин, что и у Router, но таблица хранится
+// в двух плоских матрицах, а Флойд-Уоршелл выполняется по блокам BLOCK_SIZE x BLOCK_SIZE,
+// которые помещаются в кэш L1. Независимые блоки каждой фазы
+// обрабатываются параллельно на thread_count потоках
+template <typename Weight>
+class BlockedRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    explicit BlockedRouter(Graph graph, size_t thread_count = std::thread::hardware_concurrency());
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    WeightMatrix<Weight> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+
+    std::vector<ReachedVertex<Weight>> BuildReachable(VertexId from, Weight max_weight) const;
+
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        graph_.Save(writer);
+        writer.WriteVector(weights_);
+        writer.WriteVector(prev_edges_);
+    }
+
+    template <typename Reader>
+    static BlockedRouter Load(Reader& reader) {
+        BlockedRouter router;
+        router.graph_ = Graph::Load(reader);
+        router.vertex_count_ = router.graph_.GetVertexCount();
+        router.weights_ = reader.template ReadVector<Weight>();
+        router.prev_edges_ = reader.template ReadVector<EdgeId>();
+        const size_t cell_count = router.vertex_count_ * router.vertex_count_;
+        if (router.weights_.size() != cell_count || router.prev_edges_.size() != cell_count) {
+            throw std::runtime_error("Corrupted route table data");
+        }
+        return router;
+    }
+
+private:
+    BlockedRouter() = default;
+
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight NO_ROUTE = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    void InitializeRoutes() {
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[vertex * vertex_count_ + vertex] = ZERO_WEIGHT;
+            for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                if (arc.weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+                const size_t cell = vertex * vertex_count_ + arc.to;
+                if (arc.weight < weights_[cell]) {
+                    weights_[cell] = arc.weight;
+                    prev_edges_[cell] = arc.edge_id;
+                }
+            }
+        }
+    }
+
+    // Релаксирует блок (row_block, column_block) через вершины блока through_block
+    void RelaxBlock(size_t through_block, size_t row_block, size_t column_block) {
+        const size_t through_end = std::min((through_block + 1) * BLOCK_SIZE, vertex_count_);
+        const size_t row_end = std::min((row_block + 1) * BLOCK_SIZE, vertex_count_);
+        const size_t column_begin = column_block * BLOCK_SIZE;
+        const size_t column_end = std::min(column_begin + BLOCK_SIZE, vertex_count_);
+
+        for (VertexId through = through_block * BLOCK_SIZE; through < through_end; ++through) {
+            const Weight* through_weights = &weights_[through * vertex_count_];
+            const EdgeId* through_prev_edges = &prev_edges_[through * vertex_count_];
+            for (VertexId from = row_block * BLOCK_SIZE; from < row_end; ++from) {
+                const Weight weight_from = weights_[from * vertex_count_ + through];
+                if (weight_from == NO_ROUTE) {
+                    continue;
+                }
+                const EdgeId prev_edge_from = prev_edges_[from * vertex_count_ + through];
+                Weight* row_weights = &weights_[from * vertex_count_];
+                EdgeId* row_prev_edges = &prev_edges_[from * vertex_count_];
+                for (VertexId to = column_begin; to < column_end; ++to) {
+                    if (through_weights[to] == NO_ROUTE) {
+                        continue;
+                    }
+                    const Weight candidate_weight = weight_from + through_weights[to];
+                    if (candidate_weight < row_weights[to]) {
+                        row_weights[to] = candidate_weight;
+                        row_prev_edges[to] = through_prev_edges[to] != NO_EDGE ? through_prev_edges[to]
+                                                                                : prev_edge_from;
+                    }
+                }
+            }
+        }
+    }
+
+    void RelaxRoutes(size_t thread_count) {
+        const size_t block_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (size_t through_block = 0; through_block < block_count; ++through_block) {
+            // Фаза 1: диагональный блок зависит только от себя
+            RelaxBlock(through_block, through_block, through_block);
+            // Фаза 2: блоки строки и столбца through_block зависят от диагонального
+            ParallelFor(block_count, thread_count, [&](size_t block) {
+                if (block != through_block) {
+                    RelaxBlock(through_block, through_block, block);
+                    RelaxBlock(through_block, block, through_block);
+                }
+            });
+            // Фаза 3: остальные блоки зависят только от блоков фазы 2
+            ParallelFor(block_count, thread_count, [&](size_t row_block) {
+                if (row_block == through_block) {
+                    return;
+                }
+                for (size_t column_block = 0; column_block < block_count; ++column_block) {
+                    if (column_block != through_block) {
+                        RelaxBlock(through_block, row_block, column_block);
+                    }
+                }
+            });
+        }
+    }
+
+    Graph graph_;
+    size_t vertex_count_ = 0;
+    // Матрицы vertex_count_ x vertex_count_ по строкам
+    std::vector<Weight> weights_;
+    std::vector<EdgeId> prev_edges_;
+};
+
+template <typename Weight>
+BlockedRouter<Weight>::BlockedRouter(Graph graph, size_t thread_count)
+    : graph_(std::move(graph))
+    , vertex_count_(graph_.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, NO_ROUTE)
+    , prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
+{
+    InitializeRoutes();
+    RelaxRoutes(thread_count);
+}
+
+template <typename Weight>
+std::optional<typename BlockedRouter<Weight>::RouteInfo> BlockedRouter<Weight>::BuildRoute(VertexId from,
+                                                                                           VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const size_t row = from * vertex_count_;
+    if (weights_[row + to] == NO_ROUTE) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = prev_edges_[row + to];
+         edge_id != NO_EDGE;
+         edge_id = prev_edges_[row + graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weights_[row + to], std::move(edges)};
+}
+
+template <typename Weight>
+WeightMatrix<Weight> BlockedRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& from,
+                                                              const std::vector<VertexId>& to) const {
+    WeightMatrix<Weight> matrix(from.size(), std::vector<std::optional<Weight>>(to.size()));
+    for (size_t row = 0; row < from.size(); ++row) {
+        for (size_t column = 0; column < to.size(); ++column) {
+            if (from[row] >= vertex_count_ || to[column] >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            const Weight weight = weights_[from[row] * vertex_count_ + to[column]];
+            if (weight != NO_ROUTE) {
+                matrix[row][column] = weight;
+            }
+        }
+    }
+    return matrix;
+}
+
+template <typename Weight>
+std::vector<ReachedVertex<Weight>> BlockedRouter<Weight>::BuildReachable(VertexId from, Weight max_weight) const {
+    if (from >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    std::vector<ReachedVertex<Weight>> result;
+    const Weight* row_weights = &weights_[from * vertex_count_];
+    for (VertexId to = 0; to < vertex_count_; ++to) {
+        if (row_weights[to] != NO_ROUTE && !(max_weight < row_weights[to])) {
+            result.push_back({to, row_weights[to]});
+        }
+    }
+    return result;
+}
+
+// Ничего не предвычисляет, каждый запрос - алгоритм Дейкстры
+// с бинарной кучей, O((V + E) log V) на запрос и O(V + E) памяти
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    explicit DijkstraRouter(Graph graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Один поиск на каждую начальную вершину, пока не найдены все конечные
+    WeightMatrix<Weight> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+
+    // Один поиск, который останавливается, как только минимум очереди превысит max_weight
+    std::vector<ReachedVertex<Weight>> BuildReachable(VertexId from, Weight max_weight) const;
+
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        graph_.Save(writer);
+    }
+
+    template <typename Reader>
+    static DijkstraRouter Load(Reader& reader) {
+        return DijkstraRouter(Graph::Load(reader));
+    }
+
+    const Graph& GetGraph() const {
+        return graph_;
+    }
+
+private:
+    using QueueItem = detail::QueueItem<Weight>;
+
+    // Дейкстра из from, останавливается, когда is_finished(вершина) вернет true
+    // для очередной извлеченной из очереди вершины
+    template <typename IsFinished>
+    void Search(VertexId from, std::vector<std::optional<Weight>>& weights,
+                std::vector<std::optional<EdgeId>>& prev_edges, IsFinished is_finished) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    Graph graph_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(Graph graph)
+    : graph_(std::move(graph))
+{
+    for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+        if (graph_.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    Search(from, weights, prev_edges, [to](VertexId vertex) {
+        return vertex == to;
+    });
+
+    if (!weights[to]) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = to; vertex != from; vertex = graph_.GetEdge(edges.back()).from) {
+        edges.push_back(*prev_edges[vertex]);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{*weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+WeightMatrix<Weight> DijkstraRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& from,
+                                                               const std::vector<VertexId>& to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    // Для каждой вершины - число ее вхождений в to
+    std::vector<size_t> target_counts(vertex_count);
+    for (const VertexId vertex : to) {
+        if (vertex >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        ++target_counts[vertex];
+    }
+
+    WeightMatrix<Weight> matrix;
+    matrix.reserve(from.size());
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    for (const VertexId source : from) {
+        if (source >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        std::fill(weights.begin(), weights.end(), std::nullopt);
+        size_t remaining_targets = to.size();
+        Search(source, weights, prev_edges, [&](VertexId vertex) {
+            remaining_targets -= target_counts[vertex];
+            return remaining_targets == 0;
+        });
+
+        auto& row = matrix.emplace_back();
+        row.reserve(to.size());
+        for (const VertexId target : to) {
+            row.push_back(weights[target]);
+        }
+    }
+    return matrix;
+}
+
+template <typename Weight>
+std::vector<ReachedVertex<Weight>> DijkstraRouter<Weight>::BuildReachable(VertexId from, Weight max_weight) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    std::vector<ReachedVertex<Weight>> result;
+    Search(from, weights, prev_edges, [&](VertexId vertex) {
+        if (max_weight < *weights[vertex]) {
+            return true;
+        }
+        result.push_back({vertex, *weights[vertex]});
+        return false;
+    });
+    return result;
+}
+
+template <typename Weight>
+template <typename IsFinished>
+void DijkstraRouter<Weight>::Search(VertexId from, std::vector<std::optional<Weight>>& weights,
+                                    std::vector<std::optional<EdgeId>>& prev_edges, IsFinished is_finished) const {
+    detail::MonotoneQueue<Weight> queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, from});
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+        // Устаревшая запись: вершина уже была извлечена с меньшим весом
+        if (*weights[item.vertex] < item.weight) {
+            continue;
+        }
+        if (is_finished(item.vertex)) {
+            break;
+        }
+        for (const auto& arc : graph_.GetOutgoingArcs(item.vertex)) {
+            const Weight candidate_weight = item.weight + arc.weight;
+            auto& weight_to = weights[arc.to];
+            if (!weight_to || candidate_weight < *weight_to) {
+                weight_to = candidate_weight;
+                prev_edges[arc.to] = arc.edge_id;
+                queue.push({candidate_weight, arc.to});
+            }
+        }
+    }
+}
+
+// A*: Дейкстра, направленный нижней оценкой оставшегося пути - расстоянием
+// по прямой от вершины до цели, деленным на максимальную скорость. Оценка
+// допустима, только если ни одно ребро не "быстрее" этой скорости - это
+// проверяется в конструкторе, иначе запросы выполняются обычным Дейкстрой
+template <typename Weight>
+class AStarRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    // Положение вершины в пространстве, в тех же единицах длины, что и скорость
+    struct Point {
+        double x;
+        double y;
+        double z;
+    };
+
+    // speed - максимальная скорость: единиц длины на единицу веса
+    AStarRouter(Graph graph, std::vector<Point> points, double speed);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Для матрицы целей несколько, направлять поиск не к чему
+    WeightMatrix<Weight> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const {
+        return dijkstra_.BuildWeightMatrix(from, to);
+    }
+
+    std::vector<ReachedVertex<Weight>> BuildReachable(VertexId from, Weight max_weight) const {
+        return dijkstra_.BuildReachable(from, max_weight);
+    }
+
+    // false - оценка недопустима для графа и используется обычный Дейкстра
+    bool IsBoundValid() const {
+        return is_bound_valid_;
+    }
+
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        dijkstra_.Save(writer);
+        writer.WriteVector(points_);
+        writer.Write(speed_);
+        writer.Write(is_bound_valid_);
+    }
+
+    template <typename Reader>
+    static AStarRouter Load(Reader& reader) {
+        DijkstraRouter<Weight> dijkstra = DijkstraRouter<Weight>::Load(reader);
+        std::vector<Point> points = reader.template ReadVector<Point>();
+        if (points.size() != dijkstra.GetGraph().GetVertexCount()) {
+            throw std::runtime_error("Corrupted A* vertex positions");
+        }
+        const double speed = reader.template Read<double>();
+        const bool is_bound_valid = reader.template Read<bool>();
+        return AStarRouter(std::move(dijkstra), std::move(points), speed, is_bound_valid);
+    }
+
+private:
+    using QueueItem = detail::QueueItem<Weight>;
+
+    AStarRouter(DijkstraRouter<Weight> dijkstra, std::vector<Point> points, double speed, bool is_bound_valid)
+        : dijkstra_(std::move(dijkstra))
+        , points_(std::move(points))
+        , speed_(speed)
+        , is_bound_valid_(is_bound_valid) {
+    }
+
+    Weight GetLowerBound(VertexId from, VertexId to) const {
+        const Point& lhs = points_[from];
+        const Point& rhs = points_[to];
+        const double dx = lhs.x - rhs.x;
+        const double dy = lhs.y - rhs.y;
+        const double dz = lhs.z - rhs.z;
+        return static_cast<Weight>(std::sqrt(dx * dx + dy * dy + dz * dz) / speed_);
+    }
+
+    // Оценка допустима и согласована, если для каждого ребра u -> v
+    // вес не меньше оценки между u и v: тогда по неравенству треугольника
+    // оценка до цели не убывает быстрее, чем растет пройденный вес
+    bool CheckLowerBound() const {
+        const Graph& graph = dijkstra_.GetGraph();
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < GetLowerBound(edge.from, edge.to)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    DijkstraRouter<Weight> dijkstra_;
+    std::vector<Point> points_;
+    double speed_ = 1;
+    bool is_bound_valid_ = false;
+};
+
+template <typename Weight>
+AStarRouter<Weight>::AStarRouter(Graph graph, std::vector<Point> points, double speed)
+    : dijkstra_(std::move(graph))
+    , points_(std::move(points))
+    , speed_(speed)
+{
+    if (points_.size() != dijkstra_.GetGraph().GetVertexCount()) {
+        throw std::invalid_argument("Every vertex should have a position");
+    }
+    if (!(speed_ > 0)) {
+        throw std::invalid_argument("Speed should be positive");
+    }
+    is_bound_valid_ = CheckLowerBound();
+}
+
+template <typename Weight>
+std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                       VertexId to) const {
+    if (!is_bound_valid_) {
+        return dijkstra_.BuildRoute(from, to);
+    }
+    const Graph& graph = dijkstra_.GetGraph();
+    const size_t vertex_count = graph.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    // В очереди - пройденный вес плюс оценка оставшегося
+    detail::MinQueue<Weight> queue;
+
+    weights[from] = ZERO_WEIGHT;
+    queue.push({GetLowerBound(from, to), from});
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+        const Weight weight = *weights[item.vertex];
+        // Устаревшая запись: вершина уже была извлечена с меньшим весом
+        if (weight + GetLowerBound(item.vertex, to) < item.weight) {
+            continue;
+        }
+        if (item.vertex == to) {
+            break;
+        }
+        for (const auto& arc : graph.GetOutgoingArcs(item.vertex)) {
+            const Weight candidate_weight = weight + arc.weight;
+            auto& weight_to = weights[arc.to];
+            if (!weight_to || candidate_weight < *weight_to) {
+                weight_to = candidate_weight;
+                prev_edges[arc.to] = arc.edge_id;
+                queue.push({candidate_weight + GetLowerBound(arc.to, to), arc.to});
+            }
+        }
+    }
+
+    if (!weights[to]) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = to; vertex != from; vertex = graph.GetEdge(edges.back()).from) {
+        edges.push_back(*prev_edges[vertex]);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{*weights[to], std::move(edges)};
+}
+
+// Иерархии сжатия (contraction hierarchies): вершины по очереди сжимаются
+// в порядке возрастания "важности", а пути через сжатую вершину заменяются
+// ребрами-сокращениями. Запрос - двунаправленный Дейкстра, который идет
+// только к более важным вершинам и просматривает малую часть графа
+template <typename Weight>
+class HubLabelRouter;
+
+template <typename Weight>
+class ContractionHierarchyRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    // Метки строятся по готовой иерархии и раскрывают ее ребра
+    friend class HubLabelRouter<Weight>;
+
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    explicit ContractionHierarchyRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Многие-ко-многим через корзины: по одному обратному поиску на конечную
+    // вершину и по одному прямому на начальную, вместо поиска на каждую пару
+    WeightMatrix<Weight> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+
+    // Один-ко-всем (PHAST): прямой поиск вверх из from, затем проход
+    // по всем вершинам в порядке убывания ранга по ребрам вниз.
+    // Веса больше max_weight отбрасываются на обоих этапах
+    std::vector<ReachedVertex<Weight>> BuildReachable(VertexId from, Weight max_weight) const;
+
+    size_t GetShortcutCount() const {
+        return edges_.size() - original_edge_count_;
+    }
+
+    // Примерный объем памяти иерархии в байтах, до построения. Число
+    // сокращений заранее неизвестно и принимается равным числу ребер
+    static size_t EstimateMemory(size_t vertex_count, size_t edge_count) {
+        const size_t shortcut_count = edge_count;
+        return (edge_count + shortcut_count) * (sizeof(Edge<Weight>) + sizeof(EdgeId))
+               + shortcut_count * sizeof(Shortcut)
+               + vertex_count * (sizeof(size_t) + 2 * sizeof(std::vector<EdgeId>));
+    }
+
+    // Сохраняет готовую иерархию, загрузка не повторяет сжатие
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        writer.template Write<uint64_t>(original_edge_count_);
+        writer.WriteVector(edges_);
+        writer.WriteVector(shortcuts_);
+        writer.WriteVector(ranks_);
+        for (const IncidenceLists* incidence_lists : {&upward_edges_, &downward_edges_}) {
+            for (const auto& edge_ids : *incidence_lists) {
+                writer.WriteVector(edge_ids);
+            }
+        }
+    }
+
+    template <typename Reader>
+    static ContractionHierarchyRouter Load(Reader& reader) {
+        ContractionHierarchyRouter router;
+        router.original_edge_count_ = reader.template Read<uint64_t>();
+        router.edges_ = reader.template ReadVector<Edge<Weight>>();
+        router.shortcuts_ = reader.template ReadVector<Shortcut>();
+        router.ranks_ = reader.template ReadVector<size_t>();
+        if (router.edges_.size() != router.original_edge_count_ + router.shortcuts_.size()) {
+            throw std::runtime_error("Corrupted contraction hierarchy data");
+        }
+        for (IncidenceLists* incidence_lists : {&router.upward_edges_, &router.downward_edges_}) {
+            incidence_lists->resize(router.ranks_.size());
+            for (auto& edge_ids : *incidence_lists) {
+                edge_ids = reader.template ReadVector<EdgeId>();
+            }
+        }
+        return router;
+    }
+
+private:
+    ContractionHierarchyRouter() = default;
+
+    using QueueItem = detail::QueueItem<Weight>;
+    using IncidenceLists = std::vector<std::vector<EdgeId>>;
+
+    // Ребро-сокращение заменяет пару ребер first -> second
+    struct Shortcut {
+        EdgeId first;
+        EdgeId second;
+    };
+
+    // Ближайший по весу сосед вершины и ребро до него
+    struct Neighbor {
+        VertexId vertex;
+        EdgeId edge_id;
+    };
+
+    // Вес пути от вершины корзины до конечной вершины с номером target_index
+    struct BucketItem {
+        size_t target_index;
+        Weight weight;
+    };
+
+    // Ограничение локального поиска свидетелей: если путь в обход
+    // сжимаемой вершины не найден за это число шагов, сокращение добавляется
+    static constexpr size_t WITNESS_SETTLED_LIMIT = 100;
+
+    class Contractor;
+
+    EdgeId AddShortcut(EdgeId first, EdgeId second) {
+        const auto& first_edge = edges_[first];
+        const auto& second_edge = edges_[second];
+        edges_.push_back({first_edge.from, second_edge.to, first_edge.weight + second_edge.weight});
+        shortcuts_.push_back({first, second});
+        return edges_.size() - 1;
+    }
+
+    // Полный поиск из start только к более важным вершинам: прямой по upward_edges_
+    // или обратный по downward_edges_. visit(вершина, вес) вызывается для каждой
+    // извлеченной вершины, weights после поиска снова пустые
+    template <typename Visit>
+    void SearchUpward(VertexId start, bool is_forward, std::vector<std::optional<Weight>>& weights,
+                      Visit visit) const;
+
+    // Раскрывает ребра иерархии в исходные ребра графа, сохраняя порядок
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& result) const {
+        std::vector<EdgeId> stack{edge_id};
+        while (!stack.empty()) {
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            if (current < original_edge_count_) {
+                result.push_back(current);
+            } else {
+                const Shortcut& shortcut = shortcuts_[current - original_edge_count_];
+                stack.push_back(shortcut.second);
+                stack.push_back(shortcut.first);
+            }
+        }
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    size_t original_edge_count_ = 0;
+    // Первые original_edge_count_ ребер совпадают с ребрами исходного графа
+    std::vector<Edge<Weight>> edges_;
+    std::vector<Shortcut> shortcuts_;
+    std::vector<size_t> ranks_;
+    // Ребра к более важным вершинам, по начальной вершине
+    IncidenceLists upward_edges_;
+    // Ребра из более важных вершин, по конечной вершине
+    IncidenceLists downward_edges_;
+};
+
+// Выполняет сжатие вершин, заполняя сокращения и ранги роутера
+template <typename Weight>
+class ContractionHierarchyRouter<Weight>::Contractor {
+public:
+    explicit Contractor(ContractionHierarchyRouter& router)
+        : router_(router)
+        , vertex_count_(router.ranks_.size())
+        , outgoing_(vertex_count_)
+        , incoming_(vertex_count_)
+        , contracted_(vertex_count_, false)
+        , contracted_neighbors_(vertex_count_, 0)
+        , witness_weights_(vertex_count_)
+        , is_target_(vertex_count_, false)
+    {
+        for (EdgeId edge_id = 0; edge_id < router_.edges_.size(); ++edge_id) {
+            const auto& edge = router_.edges_[edge_id];
+            if (edge.from != edge.to) {
+                outgoing_[edge.from].push_back(edge_id);
+                incoming_[edge.to].push_back(edge_id);
+            }
+        }
+    }
+
+    void Contract() {
+        using Priority = std::pair<long long, VertexId>;
+        std::priority_queue<Priority, std::vector<Priority>, std::greater<Priority>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            queue.push({ComputePriority(vertex), vertex});
+        }
+
+        size_t rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            // Приоритеты обновляются лениво: после сжатия соседей
+            // вершина могла стать важнее, чем следующая в очереди
+            const long long priority = ComputePriority(vertex);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({priority, vertex});
+                continue;
+            }
+            ContractVertex(vertex, false);
+            router_.ranks_[vertex] = rank++;
+        }
+    }
+
+private:
+    // Разность ребер: сколько сокращений добавит сжатие минус сколько
+    // ребер исчезнет, плюс штраф за уже сжатых соседей для равномерности
+    long long ComputePriority(VertexId vertex) {
+        const size_t shortcut_count = ContractVertex(vertex, true);
+        const size_t removed_count = GetNeighbors(incoming_[vertex], false).size()
+                                     + GetNeighbors(outgoing_[vertex], true).size();
+        return static_cast<long long>(shortcut_count) - static_cast<long long>(removed_count)
+               + static_cast<long long>(contracted_neighbors_[vertex]);
+    }
+
+    // Возвращает число сокращений, необходимых при сжатии вершины.
+    // Если simulate == false, сокращения добавляются в граф
+    size_t ContractVertex(VertexId vertex, bool simulate) {
+        const std::vector<Neighbor> in_neighbors = GetNeighbors(incoming_[vertex], false);
+        const std::vector<Neighbor> out_neighbors = GetNeighbors(outgoing_[vertex], true);
+
+        // Цели, в которые можно попасть в обход сжимаемой вершины,
+        // в остальные свидетелей нет и искать их не нужно
+        std::vector<Neighbor> witness_targets;
+        for (const Neighbor& out : out_neighbors) {
+            if (HasOtherIncomingEdges(out.vertex, vertex)) {
+                witness_targets.push_back(out);
+            }
+        }
+
+        size_t shortcut_count = 0;
+        for (const Neighbor& in : in_neighbors) {
+            const Weight in_weight = router_.edges_[in.edge_id].weight;
+            std::optional<Weight> max_weight;
+            for (const Neighbor& out : out_neighbors) {
+                const Weight weight = in_weight + router_.edges_[out.edge_id].weight;
+                if (out.vertex != in.vertex && (!max_weight || *max_weight < weight)) {
+                    max_weight = weight;
+                }
+            }
+            if (!max_weight) {
+                continue;
+            }
+
+            FindWitnesses(in.vertex, vertex, *max_weight, witness_targets);
+            for (const Neighbor& out : out_neighbors) {
+                if (out.vertex == in.vertex) {
+                    continue;
+                }
+                const Weight weight = in_weight + router_.edges_[out.edge_id].weight;
+                const auto& witness_weight = witness_weights_[out.vertex];
+                if (witness_weight && !(weight < *witness_weight)) {
+                    continue;
+                }
+                ++shortcut_count;
+                if (!simulate) {
+                    const EdgeId shortcut_id = router_.AddShortcut(in.edge_id, out.edge_id);
+                    outgoing_[in.vertex].push_back(shortcut_id);
+                    incoming_[out.vertex].push_back(shortcut_id);
+                }
+            }
+        }
+
+        if (!simulate) {
+            contracted_[vertex] = true;
+            // Ребра к сжатой вершине больше не нужны поиску свидетелей
+            for (const Neighbor& neighbor : in_neighbors) {
+                ++contracted_neighbors_[neighbor.vertex];
+                RemoveContractedEdges(outgoing_[neighbor.vertex], true);
+            }
+            for (const Neighbor& neighbor : out_neighbors) {
+                ++contracted_neighbors_[neighbor.vertex];
+                RemoveContractedEdges(incoming_[neighbor.vertex], false);
+            }
+            IncidenceLists::value_type().swap(outgoing_[vertex]);
+            IncidenceLists::value_type().swap(incoming_[vertex]);
+        }
+        return shortcut_count;
+    }
+
+    void RemoveContractedEdges(std::vector<EdgeId>& edge_ids, bool outgoing) {
+        edge_ids.erase(std::remove_if(edge_ids.begin(), edge_ids.end(),
+                                      [this, outgoing](EdgeId edge_id) {
+                                          const auto& edge = router_.edges_[edge_id];
+                                          return contracted_[outgoing ? edge.to : edge.from];
+                                      }),
+                       edge_ids.end());
+    }
+
+    // Несжатые соседи вершины, для каждого - только самое легкое ребро
+    std::vector<Neighbor> GetNeighbors(const std::vector<EdgeId>& edge_ids, bool outgoing) const {
+        std::vector<Neighbor> neighbors;
+        for (const EdgeId edge_id : edge_ids) {
+            const auto& edge = router_.edges_[edge_id];
+            const VertexId neighbor = outgoing ? edge.to : edge.from;
+            if (!contracted_[neighbor]) {
+                neighbors.push_back({neighbor, edge_id});
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end(), [this](const Neighbor& lhs, const Neighbor& rhs) {
+            if (lhs.vertex != rhs.vertex) {
+                return lhs.vertex < rhs.vertex;
+            }
+            return router_.edges_[lhs.edge_id].weight < router_.edges_[rhs.edge_id].weight;
+        });
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end(),
+                                    [](const Neighbor& lhs, const Neighbor& rhs) {
+                                        return lhs.vertex == rhs.vertex;
+                                    }),
+                        neighbors.end());
+        return neighbors;
+    }
+
+    bool HasOtherIncomingEdges(VertexId vertex, VertexId skipped) const {
+        for (const EdgeId edge_id : incoming_[vertex]) {
+            if (router_.edges_[edge_id].from != skipped) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Ограниченный Дейкстра из source по несжатым вершинам в обход skipped,
+    // завершается, когда все targets достигнуты окончательно
+    void FindWitnesses(VertexId source, VertexId skipped, Weight max_weight,
+                       const std::vector<Neighbor>& targets) {
+        for (const VertexId vertex : touched_) {
+            witness_weights_[vertex].reset();
+        }
+        touched_.clear();
+        size_t targets_left = 0;
+        for (const Neighbor& target : targets) {
+            if (target.vertex != source) {
+                is_target_[target.vertex] = true;
+                ++targets_left;
+            }
+        }
+        if (targets_left == 0) {
+            return;
+        }
+
+        detail::MonotoneQueue<Weight> queue;
+        witness_weights_[source] = ZERO_WEIGHT;
+        touched_.push_back(source);
+        queue.push({ZERO_WEIGHT, source});
+        size_t settled_count = 0;
+        while (!queue.empty() && settled_count < WITNESS_SETTLED_LIMIT) {
+            const QueueItem item = queue.top();
+            queue.pop();
+            if (*witness_weights_[item.vertex] < item.weight) {
+                continue;
+            }
+            if (max_weight < item.weight) {
+                break;
+            }
+            if (is_target_[item.vertex] && --targets_left == 0) {
+                break;
+            }
+            ++settled_count;
+            for (const EdgeId edge_id : outgoing_[item.vertex]) {
+                const auto& edge = router_.edges_[edge_id];
+                if (edge.to == skipped || contracted_[edge.to]) {
+                    continue;
+                }
+                const Weight candidate_weight = item.weight + edge.weight;
+                if (max_weight < candidate_weight) {
+                    continue;
+                }
+                auto& weight_to = witness_weights_[edge.to];
+                if (!weight_to) {
+                    touched_.push_back(edge.to);
+                }
+                if (!weight_to || candidate_weight < *weight_to) {
+                    weight_to = candidate_weight;
+                    queue.push({candidate_weight, edge.to});
+                }
+            }
+        }
+        for (const Neighbor& target : targets) {
+            is_target_[target.vertex] = false;
+        }
+    }
+
+    ContractionHierarchyRouter& router_;
+    const size_t vertex_count_;
+    IncidenceLists outgoing_;
+    IncidenceLists incoming_;
+    std::vector<bool> contracted_;
+    std::vector<size_t> contracted_neighbors_;
+    std::vector<std::optional<Weight>> witness_weights_;
+    std::vector<bool> is_target_;
+    std::vector<VertexId> touched_;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph)
+    : original_edge_count_(graph.GetEdgeCount())
+    , ranks_(graph.GetVertexCount())
+    , upward_edges_(graph.GetVertexCount())
+    , downward_edges_(graph.GetVertexCount())
+{
+    edges_.reserve(original_edge_count_);
+    for (EdgeId edge_id = 0; edge_id < original_edge_count_; ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        edges_.push_back(edge);
+    }
+
+    Contractor(*this).Contract();
+
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const auto& edge = edges_[edge_id];
+        if (edge.from == edge.to) {
+            continue;
+        }
+        if (ranks_[edge.from] < ranks_[edge.to]) {
+            upward_edges_[edge.from].push_back(edge_id);
+        } else {
+            downward_edges_[edge.to].push_back(edge_id);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = ranks_.size();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    // Индекс 0 - прямой поиск из from, 1 - обратный поиск из to
+    std::vector<std::optional<Weight>> weights[2] = {std::vector<std::optional<Weight>>(vertex_count),
+                                                     std::vector<std::optional<Weight>>(vertex_count)};
+    std::vector<std::optional<EdgeId>> prev_edges[2] = {std::vector<std::optional<EdgeId>>(vertex_count),
+                                                        std::vector<std::optional<EdgeId>>(vertex_count)};
+    detail::MinQueue<Weight> queues[2];
+    weights[0][from] = ZERO_WEIGHT;
+    weights[1][to] = ZERO_WEIGHT;
+    queues[0].push({ZERO_WEIGHT, from});
+    queues[1].push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+    const auto is_finished = [&](const detail::MinQueue<Weight>& queue) {
+        return queue.empty() || (best_weight && !(queue.top().weight < *best_weight));
+    };
+
+    while (!is_finished(queues[0]) || !is_finished(queues[1])) {
+        const size_t direction = is_finished(queues[0])
+                                 || (!is_finished(queues[1]) && queues[1].top().weight < queues[0].top().weight);
+        auto& queue = queues[direction];
+        const QueueItem item = queue.top();
+        queue.pop();
+        if (*weights[direction][item.vertex] < item.weight) {
+            continue;
+        }
+        if (const auto& other_weight = weights[1 - direction][item.vertex]) {
+            const Weight candidate_weight = item.weight + *other_weight;
+            if (!best_weight || candidate_weight < *best_weight) {
+                best_weight = candidate_weight;
+                meeting_vertex = item.vertex;
+            }
+        }
+
+        const IncidenceLists& incidence_lists = direction == 0 ? upward_edges_ : downward_edges_;
+        for (const EdgeId edge_id : incidence_lists[item.vertex]) {
+            const auto& edge = edges_[edge_id];
+            const VertexId next_vertex = direction == 0 ? edge.to : edge.from;
+            const Weight candidate_weight = item.weight + edge.weight;
+            auto& weight_to = weights[direction][next_vertex];
+            if (!weight_to || candidate_weight < *weight_to) {
+                weight_to = candidate_weight;
+                prev_edges[direction][next_vertex] = edge_id;
+                queue.push({candidate_weight, next_vertex});
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> hierarchy_edges;
+    for (VertexId vertex = meeting_vertex; vertex != from; vertex = edges_[hierarchy_edges.back()].from) {
+        hierarchy_edges.push_back(*prev_edges[0][vertex]);
+    }
+    std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+    for (VertexId vertex = meeting_vertex; vertex != to; vertex = edges_[hierarchy_edges.back()].to) {
+        hierarchy_edges.push_back(*prev_edges[1][vertex]);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : hierarchy_edges) {
+        UnpackEdge(edge_id, edges);
+    }
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+template <typename Visit>
+void ContractionHierarchyRouter<Weight>::SearchUpward(VertexId start, bool is_forward,
+                                                      std::vector<std::optional<Weight>>& weights,
+                                                      Visit visit) const {
+    const IncidenceLists& incidence_lists = is_forward ? upward_edges_ : downward_edges_;
+    std::vector<VertexId> touched{start};
+    detail::MonotoneQueue<Weight> queue;
+    weights[start] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, start});
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+        if (*weights[item.vertex] < item.weight) {
+            continue;
+        }
+        visit(item.vertex, item.weight);
+        for (const EdgeId edge_id : incidence_lists[item.vertex]) {
+            const auto& edge = edges_[edge_id];
+            const VertexId next_vertex = is_forward ? edge.to : edge.from;
+            const Weight candidate_weight = item.weight + edge.weight;
+            auto& weight_to = weights[next_vertex];
+            if (!weight_to) {
+                touched.push_back(next_vertex);
+            }
+            if (!weight_to || candidate_weight < *weight_to) {
+                weight_to = candidate_weight;
+                queue.push({candidate_weight, next_vertex});
+            }
+        }
+    }
+    for (const VertexId vertex : touched) {
+        weights[vertex].reset();
+    }
+}
+
+template <typename Weight>
+WeightMatrix<Weight> ContractionHierarchyRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& from,
+                                                                           const std::vector<VertexId>& to) const {
+    const size_t vertex_count = ranks_.size();
+    for (const std::vector<VertexId>* vertices : {&from, &to}) {
+        for (const VertexId vertex : *vertices) {
+            if (vertex >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+        }
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    // Обратные поиски раскладывают веса до конечных вершин по корзинам вершин
+    std::unordered_map<VertexId, std::vector<BucketItem>> buckets;
+    for (size_t target_index = 0; target_index < to.size(); ++target_index) {
+        SearchUpward(to[target_index], false, weights, [&](VertexId vertex, Weight weight) {
+            buckets[vertex].push_back({target_index, weight});
+        });
+    }
+
+    // Прямой поиск встречается с обратными в вершинах с непустой корзиной
+    WeightMatrix<Weight> matrix(from.size(), std::vector<std::optional<Weight>>(to.size()));
+    for (size_t row = 0; row < from.size(); ++row) {
+        auto& matrix_row = matrix[row];
+        SearchUpward(from[row], true, weights, [&](VertexId vertex, Weight weight) {
+            const auto it = buckets.find(vertex);
+            if (it == buckets.end()) {
+                return;
+            }
+            for (const BucketItem& item : it->second) {
+                const Weight candidate_weight = weight + item.weight;
+                auto& cell = matrix_row[item.target_index];
+                if (!cell || candidate_weight < *cell) {
+                    cell = candidate_weight;
+                }
+            }
+        });
+    }
+    return matrix;
+}
+
+template <typename Weight>
+std::vector<ReachedVertex<Weight>> ContractionHierarchyRouter<Weight>::BuildReachable(VertexId from,
+                                                                                     Weight max_weight) const {
+    const size_t vertex_count = ranks_.size();
+    if (from >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<std::optional<Weight>> weights(vertex_count);
+    std::vector<std::optional<Weight>> upward_weights(vertex_count);
+    SearchUpward(from, true, upward_weights, [&](VertexId vertex, Weight weight) {
+        if (!(max_weight < weight)) {
+            weights[vertex] = weight;
+        }
+    });
+
+    // Вершины выше по рангу уже окончательны, когда до них доходит очередь
+    std::vector<VertexId> vertices_by_rank(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        vertices_by_rank[ranks_[vertex]] = vertex;
+    }
+    std::vector<ReachedVertex<Weight>> result;
+    for (auto it = vertices_by_rank.rbegin(); it != vertices_by_rank.rend(); ++it) {
+        const VertexId vertex = *it;
+        auto& weight = weights[vertex];
+        for (const EdgeId edge_id : downward_edges_[vertex]) {
+            const auto& edge = edges_[edge_id];
+            if (const auto& weight_from = weights[edge.from]) {
+                const Weight candidate_weight = *weight_from + edge.weight;
+                if (!weight || candidate_weight < *weight) {
+                    weight = candidate_weight;
+                }
+            }
+        }
+        if (weight && max_weight < *weight) {
+            // Пути через эту вершину тоже тяжелее max_weight
+            weight.reset();
+        }
+        if (weight) {
+            result.push_back({vertex, *weight});
+        }
+    }
+    return result;
+}
+
+// Метки хабов (2-hop labels) по порядку сжатия иерархии: у каждой вершины
+// есть прямая метка - веса путей вверх по иерархии до более важных вершин-хабов,
+// и обратная - веса путей от хабов вниз до нее. Кратчайший путь проходит через
+// самую важную свою вершину, поэтому запрос - слияние двух отсортированных по
+// хабу меток без поиска по графу. Метки строятся сверху вниз по рангу из меток
+// соседей, записи, вес которых больше кратчайшего, отбрасываются
+template <typename Weight>
+class HubLabelRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Hierarchy = ContractionHierarchyRouter<Weight>;
+
+public:
+    using RouteInfo = graph::RouteInfo<Weight>;
+
+    explicit HubLabelRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Каждая клетка - слияние прямой метки строки и обратной метки столбца
+    WeightMatrix<Weight> BuildWeightMatrix(const std::vector<VertexId>& from, const std::vector<VertexId>& to) const;
+
+    // Один-ко-всем выгоднее считать по самой иерархии (PHAST)
+    std::vector<ReachedVertex<Weight>> BuildReachable(VertexId from, Weight max_weight) const {
+        return hierarchy_.BuildReachable(from, max_weight);
+    }
+
+    // Суммарное число записей в прямых и обратных метках
+    size_t GetLabelEntryCount() const {
+        return labels_[0].entries.size() + labels_[1].entries.size();
+    }
+
+    // Сохраняет иерархию и метки, загрузка не повторяет их построение
+    template <typename Writer>
+    void Save(Writer& writer) const {
+        hierarchy_.Save(writer);
+        for (const Labels& labels : labels_) {
+            writer.WriteVector(labels.offsets);
+            writer.WriteVector(labels.entries);
+        }
+    }
+
+    template <typename Reader>
+    static HubLabelRouter Load(Reader& reader) {
+        HubLabelRouter router(Hierarchy::Load(reader));
+        const size_t vertex_count = router.hierarchy_.ranks_.size();
+        const size_t edge_count = router.hierarchy_.edges_.size();
+        for (Labels& labels : router.labels_) {
+            labels.offsets = reader.template ReadVector<uint64_t>();
+            labels.entries = reader.template ReadVector<LabelEntry>();
+            const bool is_valid = labels.offsets.size() == vertex_count + 1 && labels.offsets.front() == 0
+                                  && labels.offsets.back() == labels.entries.size()
+                                  && std::is_sorted(labels.offsets.begin(), labels.offsets.end())
+                                  && std::all_of(labels.entries.begin(), labels.entries.end(),
+                                                 [vertex_count, edge_count](const LabelEntry& entry) {
+                                                     return entry.hub < vertex_count
+                                                            && (entry.edge == NO_EDGE || entry.edge < edge_count);
+                                                 });
+            if (!is_valid) {
+                throw std::runtime_error("Corrupted hub label data");
+            }
+        }
+        return router;
+    }
+
+private:
+    explicit HubLabelRouter(Hierarchy hierarchy)
+        : hierarchy_(std::move(hierarchy)) {
+    }
+
+    // Запись метки: хаб, вес пути и первое ребро иерархии на пути к хабу
+    // (для обратной метки - последнее ребро на пути от хаба). Номера
+    // в 32 битах, чтобы записи не содержали байтов выравнивания
+    struct LabelEntry {
+        uint32_t hub;
+        uint32_t edge;
+        Weight weight;
+    };
+
+    // Метки всех вершин подряд, метка вершины v - entries[offsets[v], offsets[v + 1])
+    struct Labels {
+        std::vector<uint64_t> offsets;
+        std::vector<LabelEntry> entries;
+    };
+
+    using LabelRange = ranges::Range<const LabelEntry*>;
+
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+    static constexpr Weight ZERO_WEIGHT{};
+
+    // Индекс 0 - прямые метки, 1 - обратные
+    LabelRange GetLabel(size_t direction, VertexId vertex) const {
+        const Labels& labels = labels_[direction];
+        const LabelEntry* entries = labels.entries.data();
+        return {entries + labels.offsets[vertex], entries + labels.offsets[vertex + 1]};
+    }
+
+    // Запись метки для хаба, хаб обязан в ней быть
+    static const LabelEntry& FindEntry(LabelRange label, VertexId hub) {
+        const LabelEntry* it = std::lower_bound(label.begin(), label.end(), hub,
+                                                [](const LabelEntry& entry, VertexId value) {
+                                                    return entry.hub < value;
+                                                });
+        assert(it != label.end() && it->hub == hub);
+        return *it;
+    }
+
+    // Наименьший вес пути через общий хаб двух меток и сам хаб
+    static std::optional<std::pair<Weight, VertexId>> MergeLabels(LabelRange forward, LabelRange backward);
+
+    // Строит метки вершин по убыванию ранга: запись соседа выше по рангу,
+    // продленная ребром до него, плюс сама вершина с нулевым весом
+    void BuildLabels();
+
+    Hierarchy hierarchy_;
+    Labels labels_[2];
+};
+
+template <typename Weight>
+HubLabelRouter<Weight>::HubLabelRouter(const Graph& graph)
+    : hierarchy_(graph) {
+    if (hierarchy_.edges_.size() >= NO_EDGE || hierarchy_.ranks_.size() >= NO_EDGE) {
+        throw std::length_error("Too many vertices or edges for hub labels");
+    }
+    BuildLabels();
+}
+
+template <typename Weight>
+std::optional<std::pair<Weight, VertexId>> HubLabelRouter<Weight>::MergeLabels(LabelRange forward,
+                                                                               LabelRange backward) {
+    std::optional<std::pair<Weight, VertexId>> best;
+    const LabelEntry* forward_it = forward.begin();
+    const LabelEntry* backward_it = backward.begin();
+    while (forward_it != forward.end() && backward_it != backward.end()) {
+        if (forward_it->hub < backward_it->hub) {
+            ++forward_it;
+        } else if (backward_it->hub < forward_it->hub) {
+            ++backward_it;
+        } else {
+            const Weight weight = forward_it->weight + backward_it->weight;
+            if (!best || weight < best->first) {
+                best = std::pair{weight, static_cast<VertexId>(forward_it->hub)};
+            }
+            ++forward_it;
+            ++backward_it;
+        }
+    }
+    return best;
+}
+
+template <typename Weight>
+void HubLabelRouter<Weight>::BuildLabels() {
+    const size_t vertex_count = hierarchy_.ranks_.size();
+    std::vector<VertexId> vertices_by_rank(vertex_count);
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        vertices_by_rank[hierarchy_.ranks_[vertex]] = vertex;
+    }
+
+    // Пока метки строятся не по порядку вершин, каждая хранится отдельно
+    std::vector<std::vector<LabelEntry>> vertex_labels[2] = {std::vector<std::vector<LabelEntry>>(vertex_count),
+                                                             std::vector<std::vector<LabelEntry>>(vertex_count)};
+    const auto as_range = [](const std::vector<LabelEntry>& label) {
+        return LabelRange{label.data(), label.data() + label.size()};
+    };
+    // Лучшая запись метки строящейся вершины по хабу
+    std::unordered_map<VertexId, LabelEntry> candidates;
+    for (auto it = vertices_by_rank.rbegin(); it != vertices_by_rank.rend(); ++it) {
+        const VertexId vertex = *it;
+        for (size_t direction = 0; direction < 2; ++direction) {
+            candidates.clear();
+            candidates[vertex] = {static_cast<uint32_t>(vertex), NO_EDGE, ZERO_WEIGHT};
+            const auto& incidence_lists = direction == 0 ? hierarchy_.upward_edges_ : hierarchy_.downward_edges_;
+            for (const EdgeId edge_id : incidence_lists[vertex]) {
+                const auto& edge = hierarchy_.edges_[edge_id];
+                const VertexId neighbor = direction == 0 ? edge.to : edge.from;
+                for (const LabelEntry& entry : vertex_labels[direction][neighbor]) {
+                    const Weight weight = edge.weight + entry.weight;
+                    auto [candidate, is_new] = candidates.try_emplace(entry.hub, LabelEntry{entry.hub,
+                                                                      static_cast<uint32_t>(edge_id), weight});
+                    if (!is_new && weight < candidate->second.weight) {
+                        candidate->second = {entry.hub, static_cast<uint32_t>(edge_id), weight};
+                    }
+                }
+            }
+
+            std::vector<LabelEntry> label;
+            label.reserve(candidates.size());
+            for (const auto& [hub, entry] : candidates) {
+                label.push_back(entry);
+            }
+            std::sort(label.begin(), label.end(), [](const LabelEntry& lhs, const LabelEntry& rhs) {
+                return lhs.hub < rhs.hub;
+            });
+
+            // Запись лишняя, если через другой хаб до этого хаба путь короче.
+            // Метки хабов выше по рангу уже готовы
+            std::vector<LabelEntry> pruned_label;
+            pruned_label.reserve(label.size());
+            for (const LabelEntry& entry : label) {
+                const LabelRange hub_label = as_range(vertex_labels[1 - direction][entry.hub]);
+                const auto best = entry.hub == vertex ? std::nullopt
+                                  : direction == 0 ? MergeLabels(as_range(label), hub_label)
+                                                   : MergeLabels(hub_label, as_range(label));
+                if (!best || !(best->first < entry.weight)) {
+                    pruned_label.push_back(entry);
+                }
+            }
+            vertex_labels[direction][vertex] = std::move(pruned_label);
+        }
+    }
+
+    for (size_t direction = 0; direction < 2; ++direction) {
+        Labels& labels = labels_[direction];
+        labels.offsets.reserve(vertex_count + 1);
+        labels.offsets.push_back(0);
+        for (std::vector<LabelEntry>& label : vertex_labels[direction]) {
+            labels.entries.insert(labels.entries.end(), label.begin(), label.end());
+            labels.offsets.push_back(labels.entries.size());
+            std::vector<LabelEntry>().swap(label);
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename HubLabelRouter<Weight>::RouteInfo> HubLabelRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    const size_t vertex_count = hierarchy_.ranks_.size();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const auto best = MergeLabels(GetLabel(0, from), GetLabel(1, to));
+    if (!best) {
+        return std::nullopt;
+    }
+    const VertexId hub = best->second;
+
+    // Ребра иерархии от from вверх до хаба и от хаба вниз до to
+    std::vector<EdgeId> hierarchy_edges;
+    for (VertexId vertex = from; vertex != hub; vertex = hierarchy_.edges_[hierarchy_edges.back()].to) {
+        hierarchy_edges.push_back(FindEntry(GetLabel(0, vertex), hub).edge);
+    }
+    const size_t upward_count = hierarchy_edges.size();
+    for (VertexId vertex = to; vertex != hub; vertex = hierarchy_.edges_[hierarchy_edges.back()].from) {
+        hierarchy_edges.push_back(FindEntry(GetLabel(1, vertex), hub).edge);
+    }
+    std::reverse(hierarchy_edges.begin() + upward_count, hierarchy_edges.end());
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : hierarchy_edges) {
+        hierarchy_.UnpackEdge(edge_id, edges);
+    }
+    return RouteInfo{best->first, std::move(edges)};
+}
+
+template <typename Weight>
+WeightMatrix<Weight> HubLabelRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& from,
+                                                               const std::vector<VertexId>& to) const {
+    const size_t vertex_count = hierarchy_.ranks_.size();
+    for (const std::vector<VertexId>* vertices : {&from, &to}) {
+        for (const VertexId vertex : *vertices) {
+            if (vertex >= vertex_count) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+        }
+    }
+
+    WeightMatrix<Weight> matrix(from.size(), std::vector<std::optional<Weight>>(to.size()));
+    for (size_t row = 0; row < from.size(); ++row) {
+        for (size_t column = 0; column < to.size(); ++column) {
+            if (const auto best = MergeLabels(GetLabel(0, from[row]), GetLabel(1, to[column]))) {
+                matrix[row][column] = best->first;
+            }
+        }
+    }
+    return matrix;
+}
+
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "serialization.h"
+
+#include <array>
+#include <fstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace transport_catalogue{
+
+namespace serialization{
+
+namespace{
+
+// Файл, отображенный в память только для чтения
+class MappedFile{
+public:
+    explicit MappedFile(const std::string& path){
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0){
+            throw std::runtime_error("Can't open base file: " + path);
+        }
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0){
+            close(fd);
+            throw std::runtime_error("Can't stat base file: " + path);
+        }
+        size_ = static_cast<size_t>(file_stat.st_size);
+        if(size_ != 0){
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data == MAP_FAILED){
+                close(fd);
+                throw std::runtime_error("Can't map base file: " + path);
+            }
+            data_ = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile(){
+        if(data_ != nullptr){
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char* GetData() const{
+        return data_;
+    }
+
+    size_t GetSize() const{
+        return size_;
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Остановки записываются по порядку, а в расстояниях
+// и маршрутах ссылаются на остановки по номеру в каталоге
+void SaveCatalogue(Writer& writer, const TransportCatalogue& catalogue){
+    const std::deque<Stop>& stops = catalogue.GetStops();
+    writer.Write<uint64_t>(stops.size());
+    for(const Stop& stop : stops){
+        writer.WriteString(stop.name);
+        writer.Write(stop.coords);
+    }
+
+    const StopDistances& stop_distances = catalogue.GetStopDistances();
+    writer.Write<uint64_t>(stop_distances.size());
+    for(const auto& [key, distance] : stop_distances){
+        const auto [from, to] = domain::SplitStopPairKey(key);
+        writer.Write(from);
+        writer.Write(to);
+        writer.Write(distance);
+    }
+
+    const std::deque<Bus>& buses = catalogue.GetBuses();
+    writer.Write<uint64_t>(buses.size());
+    for(const Bus& bus : buses){
+        writer.WriteString(bus.name);
+        writer.Write(bus.is_roundtrip);
+        std::vector<uint32_t> route;
+        route.reserve(bus.stops.size());
+        for(const Stop* stop : bus.stops){
+            route.push_back(stop->id);
+        }
+        writer.WriteVector(route);
+    }
+}
+
+void LoadCatalogue(Reader& reader, TransportCatalogue& catalogue){
+    std::vector<std::string_view> stop_names(reader.Read<uint64_t>());
+    for(std::string_view& name : stop_names){
+        name = reader.ReadString();
+        catalogue.AddStop(name, reader.Read<Coordinates>());
+    }
+
+    const uint64_t distance_count = reader.Read<uint64_t>();
+    for(uint64_t i = 0; i < distance_count; ++i){
+        const uint32_t from = reader.Read<uint32_t>();
+        const uint32_t to = reader.Read<uint32_t>();
+        catalogue.AddStopDistance(stop_names.at(from), stop_names.at(to), reader.Read<int>());
+    }
+
+    const uint64_t bus_count = reader.Read<uint64_t>();
+    for(uint64_t i = 0; i < bus_count; ++i){
+        std::string_view name = reader.ReadString();
+        bool is_roundtrip = reader.Read<bool>();
+        std::vector<std::string_view> route;
+        for(uint32_t stop_index : reader.ReadVector<uint32_t>()){
+            route.push_back(stop_names.at(stop_index));
+        }
+        catalogue.AddBus(name, std::move(route), is_roundtrip);
+    }
+}
+
+void SaveColor(Writer& writer, const svg::Color& color){
+    writer.Write<uint8_t>(static_cast<uint8_t>(color.index()));
+    if(const auto* name = std::get_if<std::string>(&color)){
+        writer.WriteString(*name);
+    } else if(const auto* rgb = std::get_if<svg::Rgb>(&color)){
+        writer.Write(*rgb);
+    } else if(const auto* rgba = std::get_if<svg::Rgba>(&color)){
+        writer.Write(*rgba);
+    }
+}
+
+svg::Color LoadColor(Reader& reader){
+    switch(reader.Read<uint8_t>()){
+        case 1:
+            return std::string(reader.ReadString());
+        case 2:
+            return reader.Read<svg::Rgb>();
+        case 3:
+            return reader.Read<svg::Rgba>();
+        default:
+            return svg::Color();
+    }
+}
+
+void SaveRenderSettings(Writer& writer, const map_render::RenderSettings& settings){
+    writer.Write(settings.width_);
+    writer.Write(settings.height_);
+    writer.Write(settings.padding_);
+    writer.Write(settings.stop_radius_);
+    writer.Write(settings.line_width_);
+    writer.Write(settings.bus_label_font_size_);
+    writer.WriteVector(settings.bus_label_offset_);
+    writer.Write(settings.stop_label_font_size_);
+    writer.WriteVector(settings.stop_label_offset_);
+    SaveColor(writer, settings.underlayer_color_);
+    writer.Write(settings.underlayer_width_);
+    writer.Write<uint64_t>(settings.color_palette_.size());
+    for(const svg::Color& color : settings.color_palette_){
+        SaveColor(writer, color);
+    }
+}
+
+map_render::RenderSettings LoadRenderSettings(Reader& reader){
+    map_render::RenderSettings settings;
+    settings.width_ = reader.Read<double>();
+    settings.height_ = reader.Read<double>();
+    settings.padding_ = reader.Read<double>();
+    settings.stop_radius_ = reader.Read<double>();
+    settings.line_width_ = reader.Read<double>();
+    settings.bus_label_font_size_ = reader.Read<int>();
+    settings.bus_label_offset_ = reader.ReadVector<double>();
+    settings.stop_label_font_size_ = reader.Read<int>();
+    settings.stop_label_offset_ = reader.ReadVector<double>();
+    settings.underlayer_color_ = LoadColor(reader);
+    settings.underlayer_width_ = reader.Read<double>();
+    settings.color_palette_.resize(reader.Read<uint64_t>());
+    for(svg::Color& color : settings.color_palette_){
+        color = LoadColor(reader);
+    }
+    return settings;
+}
+
+} // namespace
+
+void SaveBase(const SerializationSettings& settings, const TransportCatalogue& catalogue,
+              const map_render::RenderSettings& render_settings,
+              const transport_router::TransportRouter<double>& router,
+              const transport_router::TransportRouter<uint32_t>& fixed_router){
+    std::ofstream output(settings.file_, std::ios::binary);
+    if(!output){
+        throw std::runtime_error("Can't create base file: " + settings.file_);
+    }
+    Writer writer(output);
+    output.write(FILE_SIGNATURE, sizeof(FILE_SIGNATURE));
+    writer.Write(FILE_VERSION);
+    SaveCatalogue(writer, catalogue);
+    SaveRenderSettings(writer, render_settings);
+    if(fixed_router.IsCreated()){
+        writer.Write(transport_router::RouteWeights::FIXED_POINT);
+        fixed_router.Save(writer);
+    } else {
+        writer.Write(transport_router::RouteWeights::MINUTES);
+        router.Save(writer);
+    }
+    if(!output){
+        throw std::runtime_error("Can't write base file: " + settings.file_);
+    }
+}
+
+void LoadBase(const SerializationSettings& settings, TransportCatalogue& catalogue,
+              map_render::RenderSettings& render_settings,
+              transport_router::TransportRouter<double>& router,
+              transport_router::TransportRouter<uint32_t>& fixed_router){
+    MappedFile file(settings.file_);
+    Reader reader(file.GetData(), file.GetSize());
+    const auto signature = reader.Read<std::array<char, sizeof(FILE_SIGNATURE)>>();
+    if(std::memcmp(signature.data(), FILE_SIGNATURE, sizeof(FILE_SIGNATURE)) != 0){
+        throw std::runtime_error("Not a transport catalogue base file: " + settings.file_);
+    }
+    if(reader.Read<uint32_t>() != FILE_VERSION){
+        throw std::runtime_error("Unsupported base file version: " + settings.file_);
+    }
+    LoadCatalogue(reader, catalogue);
+    render_settings = LoadRenderSettings(reader);
+    switch(reader.Read<transport_router::RouteWeights>()){
+        case transport_router::RouteWeights::MINUTES:
+            router.Load(reader, catalogue);
+            break;
+        case transport_router::RouteWeights::FIXED_POINT:
+            fixed_router.Load(reader, catalogue);
+            break;
+        default:
+            throw std::runtime_error("Unknown routing weights in base file: " + settings.file_);
+    }
+}
+
+} // namespace serialization
+
+} // namespace transport_catalogue
\ No newline at end of file
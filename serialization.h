@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "transport_catalogue.h"
+#include "map_renderer.h"
+#include "transport_router.h"
+
+namespace transport_catalogue{
+
+namespace serialization{
+
+// Файл базы: сигнатура, версия формата и секции каталога, настроек
+// отрисовки и маршрутизатора подряд. Перед маршрутизатором записан тип его весов.
+// Числа записываются в порядке байт машины
+inline constexpr char FILE_SIGNATURE[4] = {'T', 'C', 'D', 'B'};
+inline constexpr uint32_t FILE_VERSION = 8;
+
+struct SerializationSettings{
+    std::string file_;
+};
+
+class Writer{
+public:
+    explicit Writer(std::ostream& output)
+    : output_(output){}
+
+    template<typename T>
+    void Write(const T& value){
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as is");
+        output_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void WriteVector(const std::vector<T>& values){
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as is");
+        Write<uint64_t>(values.size());
+        output_.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void WriteString(std::string_view value){
+        Write<uint64_t>(value.size());
+        output_.write(value.data(), value.size());
+    }
+
+private:
+    std::ostream& output_;
+};
+
+// Читает данные из непрерывного буфера, например отображенного в память файла
+class Reader{
+public:
+    Reader(const char* data, size_t size)
+    : data_(data), size_(size){}
+
+    template<typename T>
+    T Read(){
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as is");
+        T value;
+        std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> ReadVector(){
+        static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as is");
+        const uint64_t count = Read<uint64_t>();
+        if(count > (size_ - offset_) / sizeof(T)){
+            throw std::runtime_error("Unexpected end of serialized data");
+        }
+        std::vector<T> values(count);
+        std::memcpy(values.data(), Take(count * sizeof(T)), count * sizeof(T));
+        return values;
+    }
+
+    std::string_view ReadString(){
+        const uint64_t size = Read<uint64_t>();
+        return {Take(size), size};
+    }
+
+private:
+    const char* Take(size_t size){
+        if(size > size_ - offset_){
+            throw std::runtime_error("Unexpected end of serialized data");
+        }
+        const char* result = data_ + offset_;
+        offset_ += size;
+        return result;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+// Сохраняет каталог, настройки отрисовки и построенный маршрутизатор:
+// fixed_router, если построен он, иначе router
+void SaveBase(const SerializationSettings& settings, const TransportCatalogue& catalogue,
+              const map_render::RenderSettings& render_settings,
+              const transport_router::TransportRouter<double>& router,
+              const transport_router::TransportRouter<uint32_t>& fixed_router);
+
+// Отображает файл базы в память и восстанавливает из него
+// каталог, настройки отрисовки и маршрутизатор без повторных вычислений.
+// Маршрутизатор загружается в router или fixed_router по типу его весов
+void LoadBase(const SerializationSettings& settings, TransportCatalogue& catalogue,
+              map_render::RenderSettings& render_settings,
+              transport_router::TransportRouter<double>& router,
+              transport_router::TransportRouter<uint32_t>& fixed_router);
+
+} // namespace serialization
+
+} // namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,129 @@
+// Регрессионный тест целых весов (weights: fixed_point) на границах времени
+// запроса Reachable: отрицательное время - ничего не достижимо, как и с minutes,
+// а слишком большое не переполняет веса и дает все достижимые остановки.
+// Ответы с fixed_point сравниваются с ответами с minutes на одной сети из 30 остановок.
+//
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -pthread -I. tests/fixed_point_limits_test.cpp $(ls *.cpp | grep -v main.cpp) -o fixed_point_limits_test
+//   ./fixed_point_limits_test
+// Код возврата 0 - ответы совпали
+
+#include "json_reader.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace transport_catalogue;
+
+namespace{
+
+constexpr size_t STOP_COUNT = 30;
+const std::vector<double> MAX_TIMES = {-5, -0.0001, 0, 7.5, 60, 1e9, 1e30};
+
+size_t failure_count = 0;
+
+void Check(bool condition, const std::string& message){
+    if(!condition){
+        std::cout << "FAILED: " << message << std::endl;
+        ++failure_count;
+    }
+}
+
+// Линейный маршрут через все остановки с неровными расстояниями и запросы Reachable
+std::string MakeInput(const std::string& weights){
+    std::ostringstream input;
+    input << "{\"base_requests\": [";
+    for(size_t i = 0; i < STOP_COUNT; ++i){
+        input << "{\"type\": \"Stop\", \"name\": \"Stop " << i << "\", \"latitude\": 55.6, \"longitude\": "
+              << 37.6 + i * 0.001 << ", \"road_distances\": {";
+        if(i + 1 < STOP_COUNT){
+            input << "\"Stop " << i + 1 << "\": " << 577 + 131 * (i % 7);
+        }
+        input << "}},";
+    }
+    input << "{\"type\": \"Bus\", \"name\": \"1\", \"is_roundtrip\": false, \"stops\": [";
+    for(size_t i = 0; i < STOP_COUNT; ++i){
+        input << (i ? ", " : "") << "\"Stop " << i << "\"";
+    }
+    input << "]}], \"routing_settings\": {\"bus_wait_time\": 6, \"bus_velocity\": 37, \"weights\": \""
+          << weights << "\"}, \"stat_requests\": [";
+    int id = 0;
+    for(double max_time : MAX_TIMES){
+        input << "{\"id\": " << id++ << ", \"type\": \"Reachable\", \"from\": \"Stop 0\", \"time\": " << max_time << "},";
+    }
+    input << "{\"id\": " << id << ", \"type\": \"Reachable\", \"from\": \"Unknown\", \"time\": -5}]}";
+    return input.str();
+}
+
+json::Array Run(const std::string& weights){
+    std::istringstream input(MakeInput(weights));
+    TransportCatalogue catalogue;
+    json_reader::JsonReader reader(input);
+    reader.SendRequests(catalogue);
+    std::ostringstream output;
+    reader.GetResponses(output);
+    std::istringstream output_stream(output.str());
+    return json::Load(output_stream).GetRoot().AsArray();
+}
+
+std::map<std::string, double> GetItems(const json::Node& response){
+    std::map<std::string, double> items;
+    for(const json::Node& item : response.AsDict().at("items").AsArray()){
+        items[item.AsDict().at("stop_name").AsString()] = item.AsDict().at("time").AsDouble();
+    }
+    return items;
+}
+
+void TestWeightUnits(){
+    using Units = transport_router::WeightUnits<uint32_t>;
+    Check(Units::FromMinutes(-5) == 0, "negative minutes should become 0");
+    Check(Units::FromMinutes(std::nan("")) == 0, "NaN minutes should become 0");
+    Check(Units::FromMinutes(1e30) == std::numeric_limits<uint32_t>::max(), "huge minutes should saturate");
+    Check(Units::FromMinutes(1.25) == 1250, "1.25 minutes should be 1250 units");
+}
+
+void TestReachableLimits(){
+    const json::Array minutes = Run("minutes");
+    const json::Array fixed_point = Run("fixed_point");
+    Check(minutes.size() == MAX_TIMES.size() + 1 && fixed_point.size() == minutes.size(), "one response per request");
+
+    for(size_t i = 0; i < MAX_TIMES.size(); ++i){
+        std::ostringstream label_stream;
+        label_stream << "time " << MAX_TIMES[i];
+        const std::string label = label_stream.str();
+        const auto expected = GetItems(minutes[i]);
+        const auto actual = GetItems(fixed_point[i]);
+        Check(expected.size() == actual.size(), label + ": " + std::to_string(actual.size())
+              + " stops with fixed_point, " + std::to_string(expected.size()) + " with minutes");
+        for(const auto& [stop, time] : expected){
+            // Каждое ребро округляется до тысячной доли минуты
+            Check(actual.count(stop) && std::abs(actual.at(stop) - time) <= 0.0005 * STOP_COUNT,
+                  label + ": time to " + stop);
+        }
+        if(MAX_TIMES[i] < 0){
+            Check(actual.empty(), label + ": nothing is reachable for negative time");
+        }
+        if(MAX_TIMES[i] >= 1e9){
+            Check(actual.size() == STOP_COUNT, label + ": every stop is reachable");
+        }
+    }
+    Check(fixed_point.back().AsDict().count("error_message"), "unknown stop with negative time is not found");
+}
+
+} // namespace
+
+int main(){
+    TestWeightUnits();
+    TestReachableLimits();
+    if(failure_count != 0){
+        std::cout << failure_count << " checks FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+// Нагрузочный тест маршрутизатора: случайные запросы Route на 32 потоках
+// должны давать те же ответы, что и на одном. Проверяются FrozenRouter::BuildRoute
+// без блокировок и TransportRouter::BuildRoute через LRU-кэш маршрутов
+// для нескольких движков на одной сгенерированной сети.
+//
+// Сборка и запуск из корня репозитория:
+//   g++ -std=c++17 -O2 -pthread -I. tests/router_stress_test.cpp transport_catalogue.cpp geo.cpp -o router_stress_test
+//   ./router_stress_test
+// Для проверки гонок то же с -fsanitize=thread -g. Код возврата 0 - ответы совпали
+
+#include "transport_router.h"
+
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace transport_catalogue;
+using transport_router::RouterEngine;
+using Router = transport_router::TransportRouter<double>;
+using Route = std::optional<Router::DescribedRoute>;
+
+namespace{
+
+constexpr size_t STOP_COUNT = 150;
+constexpr size_t BUS_COUNT = 40;
+constexpr size_t STOPS_PER_BUS = 12;
+constexpr size_t QUERY_COUNT = 20000;
+// Запросы берутся из ограниченного набора пар, чтобы кэш давал попадания
+constexpr size_t QUERY_PAIR_COUNT = 1000;
+constexpr size_t THREAD_COUNT = 32;
+// Кэш меньше набора пар, поэтому маршруты в нем еще и вытесняются
+constexpr size_t ROUTE_CACHE_SIZE = 256;
+
+void FillCatalogue(TransportCatalogue& catalogue, std::mt19937& generator){
+    std::uniform_real_distribution<double> coordinate(55.5, 55.9);
+    for(size_t i = 0; i < STOP_COUNT; ++i){
+        catalogue.AddStop("Stop " + std::to_string(i), {coordinate(generator), coordinate(generator) - 18.0});
+    }
+    std::uniform_int_distribution<size_t> stop_index(0, STOP_COUNT - 1);
+    std::uniform_int_distribution<int> distance(300, 5000);
+    for(size_t bus = 0; bus < BUS_COUNT; ++bus){
+        std::vector<std::string> names;
+        while(names.size() < STOPS_PER_BUS){
+            std::string name = "Stop " + std::to_string(stop_index(generator));
+            // Соседние остановки маршрута различны, расстояние задается между ними
+            if(!names.empty() && name == names.back()){
+                continue;
+            }
+            if(!names.empty()){
+                catalogue.AddStopDistance(names.back(), name, distance(generator));
+            }
+            names.push_back(std::move(name));
+        }
+        std::vector<std::string_view> route(names.begin(), names.end());
+        catalogue.AddBus("Bus " + std::to_string(bus), std::move(route), bus % 2 == 0);
+    }
+}
+
+bool IsSameRoute(const Route& lhs, const Route& rhs){
+    if(lhs.has_value() != rhs.has_value()){
+        return false;
+    }
+    if(!lhs){
+        return true;
+    }
+    if(lhs->total_weight_ != rhs->total_weight_ || lhs->items_.size() != rhs->items_.size()){
+        return false;
+    }
+    for(size_t i = 0; i < lhs->items_.size(); ++i){
+        const auto& left = lhs->items_[i];
+        const auto& right = rhs->items_[i];
+        if(left.type_ != right.type_ || left.time_ != right.time_
+           || left.name_ != right.name_ || left.span_count_ != right.span_count_){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Отвечает на запросы на thread_count потоках, i-й ответ - на месте i-го запроса
+template<typename Query>
+std::vector<Route> AnswerQueries(const std::vector<std::pair<std::string, std::string>>& queries,
+                                 size_t thread_count, Query query){
+    std::vector<Route> answers(queries.size());
+    std::vector<std::thread> threads;
+    for(size_t thread = 0; thread < thread_count; ++thread){
+        threads.emplace_back([&, thread]{
+            for(size_t i = thread; i < queries.size(); i += thread_count){
+                answers[i] = query(queries[i].first, queries[i].second);
+            }
+        });
+    }
+    for(std::thread& thread : threads){
+        thread.join();
+    }
+    return answers;
+}
+
+size_t CountMismatches(const std::vector<Route>& expected, const std::vector<Route>& actual){
+    size_t count = 0;
+    for(size_t i = 0; i < expected.size(); ++i){
+        count += !IsSameRoute(expected[i], actual[i]);
+    }
+    return count;
+}
+
+} // namespace
+
+int main(){
+    std::mt19937 generator(2024);
+    TransportCatalogue catalogue;
+    FillCatalogue(catalogue, generator);
+
+    std::uniform_int_distribution<size_t> stop_index(0, STOP_COUNT - 1);
+    std::vector<std::pair<std::string, std::string>> pairs(QUERY_PAIR_COUNT);
+    for(auto& [from, to] : pairs){
+        from = "Stop " + std::to_string(stop_index(generator));
+        to = "Stop " + std::to_string(stop_index(generator));
+    }
+    std::uniform_int_distribution<size_t> pair_index(0, QUERY_PAIR_COUNT - 1);
+    std::vector<std::pair<std::string, std::string>> queries(QUERY_COUNT);
+    for(auto& query : queries){
+        query = pairs[pair_index(generator)];
+    }
+
+    size_t failure_count = 0;
+    for(RouterEngine engine : {RouterEngine::ALL_PAIRS_BLOCKED, RouterEngine::ON_DEMAND,
+                               RouterEngine::CONTRACTION_HIERARCHIES, RouterEngine::RAPTOR,
+                               RouterEngine::A_STAR, RouterEngine::HUB_LABELS}){
+        transport_router::RoutingSettings settings;
+        settings.bus_wait_time_ = 6;
+        settings.bus_velocity_ = 40;
+        settings.engine_ = engine;
+        settings.route_cache_size_ = ROUTE_CACHE_SIZE;
+
+        Router router;
+        router.SetSettings(settings);
+        router.CreateGraph(catalogue);
+        const auto frozen = router.GetFrozenRouter();
+        const auto frozen_query = [&frozen](const std::string& from, const std::string& to){
+            return frozen->BuildRoute(from, to);
+        };
+        const auto cached_query = [&router](const std::string& from, const std::string& to){
+            return router.BuildRoute(from, to);
+        };
+
+        const std::vector<Route> expected = AnswerQueries(queries, 1, frozen_query);
+        const size_t frozen_mismatches = CountMismatches(expected, AnswerQueries(queries, THREAD_COUNT, frozen_query));
+        const size_t cached_mismatches = CountMismatches(expected, AnswerQueries(queries, THREAD_COUNT, cached_query));
+        const size_t found_count = std::count_if(expected.begin(), expected.end(), [](const Route& route){
+            return route.has_value();
+        });
+
+        std::cout << transport_router::GetEngineName(engine) << ": " << found_count << " of " << queries.size()
+                  << " routes found, mismatches on " << THREAD_COUNT << " threads: " << frozen_mismatches
+                  << " frozen, " << cached_mismatches << " cached (cache hits " << router.GetRouteCacheHits()
+                  << ", misses " << router.GetRouteCacheMisses() << ")" << std::endl;
+        failure_count += frozen_mismatches + cached_mismatches;
+    }
+
+    if(failure_count != 0){
+        std::cout << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <unordered_set>
@@ -10,49 +11,62 @@ using transport_catalogue::domain::BusInfo;
 using namespace transport_catalogue;
 
 void TransportCatalogue::AddStop(std::string_view stop_name, const Coordinates coords){
-    stops_.push_back({std::string(stop_name), coords});
-    stopname_to_stop_[stops_.back().name] = &stops_.back();
-    stop_to_buses_[&stops_.back()];
+    const StopId id = static_cast<StopId>(stops_.size());
+    stops_.push_back({std::string(stop_name), coords, id});
+    stopname_to_id_[stops_.back().name] = id;
+    stop_buses_.emplace_back();
+    frozen_stop_names_.Clear();
 }
 
 void TransportCatalogue::AddStopDistance(std::string_view stop_name, std::string_view other_stop_name, int distance){
     const Stop* stop = FindStop(stop_name);
     const Stop* other_stop = FindStop(other_stop_name);
-    std::pair<const Stop*, const Stop*> key = {stop, other_stop};
-    stops_distances_[key] = distance;
-
-    std::pair<const Stop*, const Stop*> reverse_key = {other_stop, stop};
-    if(!stops_distances_.count(reverse_key)){
-        stops_distances_[reverse_key] = distance;
-    }
+    stops_distances_[domain::MakeStopPairKey(stop->id, other_stop->id)] = distance;
+    stops_distances_.emplace(domain::MakeStopPairKey(other_stop->id, stop->id), distance);
 }
 
 
 const Stop* TransportCatalogue::FindStop(std::string_view stop_name) const{
-    if(stopname_to_stop_.count(std::string(stop_name))){
-        return stopname_to_stop_.at(std::string(stop_name));
+    if(frozen_stop_names_.IsBuilt()){
+        const uint32_t id = frozen_stop_names_.Find(stop_name);
+        return id == PerfectHashIndex::NOT_FOUND ? nullptr : &stops_[id];
     }
-    return nullptr;
+    auto it = stopname_to_id_.find(stop_name);
+    return it == stopname_to_id_.end() ? nullptr : &stops_[it->second];
 }
 
 void TransportCatalogue::AddBus(std::string_view bus_name, std::vector<std::string_view> route, bool is_roundtrip){
+    const BusId id = static_cast<BusId>(buses_.size());
     std::vector<const Stop*> stops_for_bus;
+    stops_for_bus.reserve(route.size());
     for(const std::string_view stop_name : route){
         const Stop* stop = FindStop(stop_name);
         stops_for_bus.push_back(stop);
-        stop_to_buses_.at(stop).insert(std::string(bus_name));
+        // Маршрут добавляется целиком, поэтому его повтор может быть только последним
+        std::vector<BusId>& stop_buses = stop_buses_[stop->id];
+        if(stop_buses.empty() || stop_buses.back() != id){
+            stop_buses.push_back(id);
+        }
     }
-    buses_.push_back({std::string(bus_name), stops_for_bus, is_roundtrip});
-    busname_to_bus_[buses_.back().name] = &buses_.back();
+    buses_.push_back({std::string(bus_name), std::move(stops_for_bus), is_roundtrip, id});
+    busname_to_id_[buses_.back().name] = id;
+    frozen_bus_names_.Clear();
 }
 
 const Bus* TransportCatalogue::FindBus(std::string_view bus_name) const{
-    if(busname_to_bus_.count(std::string(bus_name))){
-        return busname_to_bus_.at(std::string(bus_name));
+    if(frozen_bus_names_.IsBuilt()){
+        const uint32_t id = frozen_bus_names_.Find(bus_name);
+        return id == PerfectHashIndex::NOT_FOUND ? nullptr : &buses_[id];
     }
-    return nullptr;
+    auto it = busname_to_id_.find(bus_name);
+    return it == busname_to_id_.end() ? nullptr : &buses_[it->second];
 }
 
+void TransportCatalogue::FreezeNames(){
+    // Если индекс не построился, поиск остается в хеш-таблицах
+    frozen_stop_names_.Build({stopname_to_id_.begin(), stopname_to_id_.end()});
+    frozen_bus_names_.Build({busname_to_id_.begin(), busname_to_id_.end()});
+}
 
 BusInfo TransportCatalogue::GetBusInfo(std::string_view bus_name) const{
     const Bus* bus = FindBus(bus_name);
@@ -81,7 +95,7 @@ StopInfo TransportCatalogue::GetStopInfo(std::string_view stop_name) const{
         return result;
     }
     result.is_find = true;
-    result.buses = GetSetBuses(stop);
+    result.buses = GetStopBuses(stop);
     return result;
 }
 
@@ -101,22 +115,25 @@ const std::deque<Stop>& TransportCatalogue::GetStops() const{
     return stops_;
 }
 
-const std::unordered_map<PairStops, int, domain::StopsPtrPairHasher>& TransportCatalogue::GetStopDistances() const{
+const StopDistances& TransportCatalogue::GetStopDistances() const{
     return stops_distances_;
 }
 
+int TransportCatalogue::GetDistance(const Stop* from, const Stop* to) const{
+    return stops_distances_.at(domain::MakeStopPairKey(from->id, to->id));
+}
+
 
 int TransportCatalogue::GetStopsOnRoute(const Bus* bus) const{
     return bus->stops.size();
 }
 
 int TransportCatalogue::GetUniqueStops(const Bus* bus) const{
-    std::vector<const Stop*> stops = bus->stops;
-    std::unordered_set<std::string> names_stops;
-    for(const Stop* stop : stops){
-        names_stops.insert(stop->name);
+    std::unordered_set<StopId> unique_stops;
+    for(const Stop* stop : bus->stops){
+        unique_stops.insert(stop->id);
     }
-    return names_stops.size();
+    return unique_stops.size();
 }
 
 double TransportCatalogue::GetLengthBus(const Bus* bus) const{
@@ -135,13 +152,18 @@ int TransportCatalogue::GetRouteLength(const Bus* bus) const{
     size_t amount_stops = bus->stops.size();
     if(amount_stops != 0){
         for(size_t i = 0; i < amount_stops - 1; ++i){
-            std::pair<const Stop*, const Stop*> key {bus->stops[i], bus->stops[i+1]};
-            result += stops_distances_.at(key);
+            result += GetDistance(bus->stops[i], bus->stops[i+1]);
         }
     }
     return result;
 }
 
-std::set<std::string> TransportCatalogue::GetSetBuses(const Stop* stop) const{
-    return stop_to_buses_.at(stop);
+std::vector<std::string_view> TransportCatalogue::GetStopBuses(const Stop* stop) const{
+    std::vector<std::string_view> result;
+    result.reserve(stop_buses_[stop->id].size());
+    for(BusId bus : stop_buses_[stop->id]){
+        result.push_back(buses_[bus].name);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
 }
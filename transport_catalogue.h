@@ -1,6 +1,5 @@
 #pragma once
 #include <deque>
-#include <set>
 #include <unordered_map>
 #include <string>
 #include <string_view>
@@ -8,6 +7,7 @@
 #include <map>
 
 #include "domain.h"
+#include "perfect_hash.h"
 
 namespace transport_catalogue{
 
@@ -16,10 +16,13 @@ using geo::Coordinates;
 using geo::Distance;
 using domain::Stop;
 using domain::Bus;
+using domain::StopId;
+using domain::BusId;
 using domain::StopInfo;
 using domain::BusInfo;
 
-using PairStops = std::pair<const Stop*, const Stop*>;
+// Расстояния по дорогам по ключу domain::MakeStopPairKey
+using StopDistances = std::unordered_map<uint64_t, int>;
 
 class TransportCatalogue {
 public:
@@ -28,12 +31,17 @@ public:
 	const Stop* FindStop(std::string_view stop_name) const;
 	void AddBus(std::string_view bus_name, std::vector<std::string_view> route, bool is_roundtrip);
 	const Bus* FindBus(std::string_view bus_name) const;
+	// Строит неизменяемые индексы названий для обслуживания запросов без изменений
+	// каталога. Добавление остановки или маршрута сбрасывает индекс
+	void FreezeNames();
 	BusInfo GetBusInfo(std::string_view bus_name) const;
 	StopInfo GetStopInfo(std::string_view stop_name) const;
 	std::map<std::string_view, const Bus*> GetSortedBuses() const;
 	const std::deque<Bus>& GetBuses() const;
 	const std::deque<Stop>& GetStops() const;
-	const std::unordered_map<PairStops, int, domain::StopsPtrPairHasher>& GetStopDistances() const;
+	const StopDistances& GetStopDistances() const;
+	// Расстояние по дороге от from до to, std::out_of_range - если оно не задано
+	int GetDistance(const Stop* from, const Stop* to) const;
 private:
 
 	int GetStopsOnRoute(const Bus* bus) const;
@@ -41,17 +49,22 @@ private:
 	int GetRouteLength(const Bus* bus) const;
 	double GetLengthBus(const Bus* bus) const;
 
-	std::set<std::string> GetSetBuses(const Stop* stop) const;
+	std::vector<std::string_view> GetStopBuses(const Stop* stop) const;
 
+	// Названия хранятся один раз в stops_ и buses_, словари ссылаются на них
 	std::deque<Stop> stops_; 
-	std::unordered_map<std::string, Stop*> stopname_to_stop_;
+	std::unordered_map<std::string_view, StopId> stopname_to_id_;
 
 	std::deque<Bus> buses_;	
-	std::unordered_map<std::string, Bus*> busname_to_bus_;
+	std::unordered_map<std::string_view, BusId> busname_to_id_;
 
-	std::unordered_map<const Stop*, std::set<std::string>> stop_to_buses_;
+	PerfectHashIndex frozen_stop_names_;
+	PerfectHashIndex frozen_bus_names_;
 
-	std::unordered_map<PairStops, int, domain::StopsPtrPairHasher> stops_distances_;
+	// Маршруты через каждую остановку по номеру остановки, без повторов
+	std::vector<std::vector<BusId>> stop_buses_;
+
+	StopDistances stops_distances_;
 };
 
 }; //namespace transport_catalogue
\ No newline at end of file
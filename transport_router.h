@@ -1,9 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
 #include <optional>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <variant>
 
 #include "transport_catalogue.h"
+#include "lru_cache.h"
 #include "router.h"
+#include "raptor_router.h"
 
 using std::string_literals::operator""s;
 
@@ -11,168 +29,1212 @@ namespace transport_catalogue{
 
 namespace transport_router{
 
+// Движок поиска кратчайших путей по графу
+enum class RouterEngine{
+    ALL_PAIRS,  // таблица всех пар при построении, запрос - O(длины пути)
+    ALL_PAIRS_COMPACT,  // та же таблица в компактном плоском виде, примерно в 4 раза меньше памяти
+    ALL_PAIRS_BLOCKED,  // та же таблица, но плоская и вычисляется по блокам на нескольких потоках
+    ON_DEMAND,  // Дейкстра на каждый запрос, без предвычислений
+    CONTRACTION_HIERARCHIES,  // предварительное сжатие графа, быстрый двунаправленный поиск
+    RAPTOR,  // поиск по раундам прямо по маршрутам автобусов, граф не строится
+    A_STAR,  // A* с оценкой по расстоянию до цели по прямой, без предвычислений
+    HUB_LABELS,  // метки хабов по иерархии сжатия, запрос - слияние двух меток
+    AUTO  // выбирается по размеру графа и бюджету памяти при построении
+};
+
+inline std::string_view GetEngineName(RouterEngine engine){
+    switch(engine){
+        case RouterEngine::ALL_PAIRS: return "all_pairs";
+        case RouterEngine::ALL_PAIRS_COMPACT: return "all_pairs_compact";
+        case RouterEngine::ALL_PAIRS_BLOCKED: return "all_pairs_blocked";
+        case RouterEngine::ON_DEMAND: return "on_demand";
+        case RouterEngine::CONTRACTION_HIERARCHIES: return "contraction_hierarchies";
+        case RouterEngine::RAPTOR: return "raptor";
+        case RouterEngine::A_STAR: return "a_star";
+        case RouterEngine::HUB_LABELS: return "hub_labels";
+        case RouterEngine::AUTO: return "auto";
+    }
+    return "unknown";
+}
+
+// Способ построения графа маршрутов
+enum class GraphModel{
+    // 2 вершины на остановку, ребро на каждую пару остановок каждого маршрута, O(N²) ребер на маршрут
+    STOP_PAIRS,
+    // вершина на остановку и на каждую позицию (автобус, остановка), O(N) ребер на маршрут
+    ROUTE_PATTERNS
+};
+
+// Вид ребра графа маршрутов и элемента описания маршрута
+enum class EdgeType : uint8_t{
+    ALIGHT,  // высадка в модели шаблонов маршрутов, в описание маршрута не попадает
+    WAIT,  // ожидание автобуса на остановке
+    BUS  // поездка на автобусе
+};
+
+// Представление весов ребер и времен в пути
+enum class RouteWeights{
+    MINUTES,  // вещественные минуты, TransportRouter<double>
+    FIXED_POINT  // целые тысячные доли минуты, TransportRouter<uint32_t>. Каждое ребро
+                 // округляется до 0.001 минуты, ошибки складываются вдоль пути
+};
+
+// Перевод минут в единицы весов маршрутизатора и обратно.
+// Целые веса хранятся с фиксированной точкой: PER_MINUTE единиц в минуте
+template<typename Weight>
+struct WeightUnits{
+    static constexpr double PER_MINUTE = std::is_integral_v<Weight> ? 1000 : 1;
+
+    // Целые веса не бывают отрицательными и ограничены сверху: отрицательное
+    // время становится нулем, слишком большое - наибольшим весом
+    static Weight FromMinutes(double minutes){
+        if constexpr(std::is_integral_v<Weight>){
+            const double units = std::round(minutes * PER_MINUTE);
+            if(!(units > 0)){
+                return Weight{};
+            }
+            if(units >= static_cast<double>(std::numeric_limits<Weight>::max())){
+                return std::numeric_limits<Weight>::max();
+            }
+            return static_cast<Weight>(units);
+        } else {
+            return static_cast<Weight>(minutes);
+        }
+    }
+
+    static double ToMinutes(Weight weight){
+        return static_cast<double>(weight) / PER_MINUTE;
+    }
+};
+
+// Профиль маршрутизации: тот же граф и движок с другими временем ожидания и скоростью
+struct RoutingProfile{
+    std::string name_;
+    size_t bus_wait_time_ = 1;
+    size_t bus_velocity_ = 1;
+};
+
 struct RoutingSettings{
     size_t bus_wait_time_ = 1;
     size_t bus_velocity_ = 1;
+    GraphModel graph_model_ = GraphModel::STOP_PAIRS;
+    RouterEngine engine_ = RouterEngine::ALL_PAIRS;
+    // Число потоков для построения графа и ALL_PAIRS_BLOCKED, 0 - по числу ядер
+    size_t thread_count_ = 0;
+    // Сколько последних маршрутов хранить в кэше BuildRoute, 0 - без кэша
+    size_t route_cache_size_ = 0;
+    RouteWeights weights_ = RouteWeights::MINUTES;
+    // Сколько памяти может занять движок, выбранный для AUTO, в мегабайтах
+    size_t memory_budget_mb_ = 256;
+    // Писать ли в std::clog размеры графа до и после сжатия и его компоненты
+    bool log_graph_stats_ = false;
+    // Дополнительные профили, которые строятся вместе с основным маршрутизатором
+    std::vector<RoutingProfile> profiles_;
 };
 
 template<typename Weight>
 class TransportRouter{
 public:
     using Graph = graph::DirectedWeightedGraph<Weight>;
-    using StopDistances = std::unordered_map<PairStops, int, domain::StopsPtrPairHasher>;
-    using RouteInfo = typename graph::Router<Weight>::RouteInfo;
-    
+    using RouteInfo = graph::RouteInfo<Weight>;
+    using Units = WeightUnits<Weight>;
+    using WeightMatrix = graph::WeightMatrix<Weight>;
+    // Остановка и время в пути до нее
+    using ReachableStops = std::vector<std::pair<std::string_view, Weight>>;
+    using CompactRouter = graph::Router<Weight, graph::CompactRouteStorage<Weight>>;
+    using RouterVariant = std::variant<std::monostate,
+                                       graph::Router<Weight>,
+                                       CompactRouter,
+                                       graph::BlockedRouter<Weight>,
+                                       graph::DijkstraRouter<Weight>,
+                                       graph::ContractionHierarchyRouter<Weight>,
+                                       RaptorRouter<Weight>,
+                                       graph::AStarRouter<Weight>,
+                                       graph::HubLabelRouter<Weight>>;
 
-    // Вспомогательные классы для описания
-    // маршрута находятся внутри класса 
-    // т.к. внутри них поле шаблонного типа
-    struct BaseEdge{
-        BaseEdge(std::string type, Weight time)
-        : type_(std::move(type)), time_(time){}
 
-        std::string type_;
+    // Элемент описания маршрута: ожидание на остановке name_ или поездка
+    // на автобусе name_ через span_count_ остановок. Название указывает
+    // на строку каталога, поэтому элемент не владеет памятью
+    struct RouteItem{
+        EdgeType type_;
         Weight time_;
-    };
-
-    struct WaitEdge : public BaseEdge{
-        WaitEdge(std::string type, Weight time, std::string stop_name)
-        : BaseEdge(std::move(type), time), stop_name_(stop_name){}
-
-        std::string stop_name_;
-    };
-
-    struct BusEdge : public BaseEdge{
-        BusEdge(std::string type, Weight time, std::string bus, int span_count)
-        : BaseEdge(std::move(type), time), bus_(bus), span_count_(span_count){}
-        std::string bus_;
-        int span_count_;
+        std::string_view name_;
+        int span_count_ = 0;
     };
 
     struct DescribedRoute{
-        DescribedRoute(Weight total_weight, std::vector<std::shared_ptr<BaseEdge>> items)
+        DescribedRoute(Weight total_weight, std::vector<RouteItem> items)
         : total_weight_(total_weight), items_(std::move(items)){}
         Weight total_weight_;
-        std::vector<std::shared_ptr<BaseEdge>> items_;
+        std::vector<RouteItem> items_;
     };
 
+    // Неизменяемый построенный маршрутизатор: граф, движок и описания ребер.
+    // Все запросы к нему константные и не используют блокировок,
+    // поэтому один объект можно разделять между любым числом потоков
+    class FrozenRouter;
+
     // Граф создается не сразу, а тогда
     // когда понадобится обработать stat_request: Route
     TransportRouter()
     : settings_(){}
 
     bool IsCreated() const{
-        return router_.has_value();
+        return frozen_ != nullptr;
     }
 
     void CreateGraph(const TransportCatalogue& catalogue){
-        // Создается граф с 2 * N вершинами, N - количество остановок
-        size_t vertex_count = 2 * catalogue.GetStops().size();
-        Graph graph(vertex_count);
+        route_cache_.Clear();
+        frozen_ = std::make_shared<const FrozenRouter>(catalogue, settings_);
+        CreateProfiles(catalogue);
+    }
+
+    // Перевзвешивает построенный граф под новые время ожидания и скорость,
+    // не перестраивая его. Профили остаются прежними
+    void Reweight(const TransportCatalogue& catalogue, size_t bus_wait_time, size_t bus_velocity){
+        if(!frozen_){
+            throw std::logic_error("Routing graph should be created before reweighting");
+        }
+        settings_.bus_wait_time_ = bus_wait_time;
+        settings_.bus_velocity_ = bus_velocity;
+        route_cache_.Clear();
+        frozen_ = frozen_->Reweight(catalogue, bus_wait_time, bus_velocity);
+    }
 
-        AddStops(catalogue.GetStops());
-        AddWaitingEdges(graph, vertex_count);
-        AddBusesEdges(graph, catalogue);
-        router_.emplace(graph);
+    // Построенный маршрутизатор профиля, пустое название - основной.
+    // nullptr до CreateGraph или для неизвестного профиля. Остается
+    // действительным и после повторного CreateGraph или SetSettings
+    std::shared_ptr<const FrozenRouter> GetFrozenRouter(std::string_view profile = {}) const{
+        if(profile.empty()){
+            return frozen_;
+        }
+        auto it = profile_routers_.find(profile);
+        if(it == profile_routers_.end()){
+            return nullptr;
+        }
+        return it->second;
     }
 
-    std::optional<DescribedRoute> BuildRoute(std::string from, std::string to){
-        if(IsCreated()){
-            auto route = (*router_).BuildRoute(stops_id_.at(from), stops_id_.at(to));
-            if(route.has_value()){
-                return DescribeRoute(*route);
+    // Готовые описания маршрутов основного профиля берутся из кэша по паре остановок.
+    // После CreateGraph можно вызывать из нескольких потоков
+    std::optional<DescribedRoute> BuildRoute(std::string_view from, std::string_view to,
+                                             std::string_view profile = {}){
+        if(!profile.empty()){
+            std::shared_ptr<const FrozenRouter> frozen = GetFrozenRouter(profile);
+            return frozen ? frozen->BuildRoute(from, to) : std::nullopt;
+        }
+        if(!frozen_){
+            return std::nullopt;
+        }
+        if(route_cache_.GetCapacity() == 0){
+            return frozen_->BuildRoute(from, to);
+        }
+        std::optional<StopId> from_id = frozen_->FindStopId(from);
+        std::optional<StopId> to_id = frozen_->FindStopId(to);
+        if(!from_id || !to_id){
+            return std::nullopt;
+        }
+        const uint64_t key = domain::MakeStopPairKey(*from_id, *to_id);
+        {
+            std::lock_guard guard(route_cache_mutex_);
+            if(const auto* route = route_cache_.Find(key)){
+                return *route;
             }
         }
-        return std::nullopt;
+        // Поиск идет без блокировки, построенный маршрутизатор не меняется
+        std::optional<DescribedRoute> route = frozen_->BuildRoute(from, to);
+        std::lock_guard guard(route_cache_mutex_);
+        route_cache_.Put(key, route);
+        return route;
     }
 
+    size_t GetRouteCacheHits() const{
+        std::lock_guard guard(route_cache_mutex_);
+        return route_cache_.GetHitCount();
+    }
+
+    size_t GetRouteCacheMisses() const{
+        std::lock_guard guard(route_cache_mutex_);
+        return route_cache_.GetMissCount();
+    }
+
+    std::optional<WeightMatrix> BuildRouteMatrix(const std::vector<std::string>& from,
+                                                 const std::vector<std::string>& to,
+                                                 std::string_view profile = {}) const{
+        std::shared_ptr<const FrozenRouter> frozen = GetFrozenRouter(profile);
+        if(!frozen){
+            return std::nullopt;
+        }
+        return frozen->BuildRouteMatrix(from, to);
+    }
+
+    std::optional<ReachableStops> BuildReachable(std::string_view from, Weight max_time,
+                                                 std::string_view profile = {}) const{
+        std::shared_ptr<const FrozenRouter> frozen = GetFrozenRouter(profile);
+        if(!frozen){
+            return std::nullopt;
+        }
+        return frozen->BuildReachable(from, max_time);
+    }
+
+    // Кэш маршрутов сбрасывается: они могли быть найдены при других настройках
     void SetSettings(RoutingSettings settings){
         settings_ = settings;
+        route_cache_ = RouteCache(settings_.route_cache_size_);
+    }
+
+    // Сохраняет настройки и построенный маршрутизатор вместе с таблицами движка
+    template<typename Writer>
+    void Save(Writer& writer) const{
+        if(!frozen_){
+            throw std::logic_error("Routing graph should be created before saving");
+        }
+        writer.Write(settings_.bus_wait_time_);
+        writer.Write(settings_.bus_velocity_);
+        writer.Write(settings_.graph_model_);
+        writer.Write(settings_.engine_);
+        writer.Write(settings_.thread_count_);
+        writer.Write(settings_.route_cache_size_);
+        // Профили сохраняются только настройками и перевзвешиваются при загрузке
+        writer.template Write<uint64_t>(settings_.profiles_.size());
+        for(const RoutingProfile& profile : settings_.profiles_){
+            writer.WriteString(profile.name_);
+            writer.Write(profile.bus_wait_time_);
+            writer.Write(profile.bus_velocity_);
+        }
+        frozen_->Save(writer);
+    }
+
+    // Восстанавливает маршрутизатор, сохраненный Save, для того же каталога
+    template<typename Reader>
+    void Load(Reader& reader, const TransportCatalogue& catalogue){
+        settings_.bus_wait_time_ = reader.template Read<size_t>();
+        settings_.bus_velocity_ = reader.template Read<size_t>();
+        settings_.graph_model_ = reader.template Read<GraphModel>();
+        settings_.engine_ = reader.template Read<RouterEngine>();
+        settings_.thread_count_ = reader.template Read<size_t>();
+        settings_.route_cache_size_ = reader.template Read<size_t>();
+        settings_.profiles_.resize(reader.template Read<uint64_t>());
+        for(RoutingProfile& profile : settings_.profiles_){
+            profile.name_ = std::string(reader.ReadString());
+            profile.bus_wait_time_ = reader.template Read<size_t>();
+            profile.bus_velocity_ = reader.template Read<size_t>();
+        }
+        settings_.weights_ = std::is_integral_v<Weight> ? RouteWeights::FIXED_POINT : RouteWeights::MINUTES;
+        route_cache_ = RouteCache(settings_.route_cache_size_);
+        frozen_ = FrozenRouter::Load(reader, catalogue, settings_);
+        CreateProfiles(catalogue);
     }
 private:
-    // Добавляет остановки в словарь и нумерует их
-    void AddStops(const std::deque<Stop>& stops){
-        size_t vertex_id = 0;
-        for(const Stop& stop : stops){
-            stops_id_[stop.name] = vertex_id;
-            id_stops_[vertex_id] = stop.name;
-            vertex_id += 2;
+    // Ключ кэша - пара номеров остановок domain::MakeStopPairKey
+    using RouteCache = LruCache<uint64_t, std::optional<DescribedRoute>>;
+
+    // Маршрутизаторы профилей перевзвешиваются из основного, граф заново не строится
+    void CreateProfiles(const TransportCatalogue& catalogue){
+        profile_routers_.clear();
+        for(const RoutingProfile& profile : settings_.profiles_){
+            profile_routers_[profile.name_] = frozen_->Reweight(catalogue, profile.bus_wait_time_, profile.bus_velocity_);
+        }
+    }
+
+    RoutingSettings settings_;
+    std::shared_ptr<const FrozenRouter> frozen_;
+    // Маршрутизаторы профилей по названиям, маршруты профилей не кэшируются
+    std::map<std::string, std::shared_ptr<const FrozenRouter>, std::less<>> profile_routers_;
+    // Последние найденные маршруты по паре номеров остановок
+    RouteCache route_cache_;
+    mutable std::mutex route_cache_mutex_;
+};
+
+template<typename Weight>
+class TransportRouter<Weight>::FrozenRouter{
+public:
+    // Строит граф по каталогу и движок, выбранный в настройках
+    FrozenRouter(const TransportCatalogue& catalogue, RoutingSettings settings)
+    : catalogue_(&catalogue), settings_(settings){
+        if(settings_.engine_ == RouterEngine::RAPTOR){
+            router_.template emplace<RaptorRouter<Weight>>(catalogue, GetWaitTime(), GetVelocity());
+            return;
+        }
+
+        // В граф попадают только остановки, через которые проходят маршруты
+        Topology topology;
+        switch(settings_.graph_model_){
+            case GraphModel::STOP_PAIRS:{
+                // Создается граф с 2 * N вершинами, N - количество остановок
+                topology.vertex_count = AddStopVertices(catalogue, 2);
+                AddWaitingEdges(topology);
+                AddBusesEdges(topology, catalogue);
+                break;
+            }
+            case GraphModel::ROUTE_PATTERNS:{
+                // Создается граф с N + M вершинами, N - количество остановок,
+                // M - суммарное количество остановок на всех маршрутах
+                size_t stop_vertex_count = AddStopVertices(catalogue, 1);
+                size_t vertex_count = stop_vertex_count;
+                for(const Bus& bus : catalogue.GetBuses()){
+                    if(bus.stops.size() > 1){
+                        vertex_count += bus.stops.size();
+                    } else {
+                        compaction_.dropped_vertex_count += bus.stops.size();
+                    }
+                }
+                topology.vertex_count = vertex_count;
+                AddRoutePatternEdges(topology, catalogue, stop_vertex_count);
+                break;
+            }
+        }
+        topology_ = std::make_shared<const Topology>(std::move(topology));
+        Graph graph = BuildGraph();
+        components_ = graph::ComponentIndex(graph);
+        if(settings_.log_graph_stats_){
+            LogCompaction();
+            LogComponents();
         }
+        CreateRouter(std::move(graph), catalogue);
     }
 
-    // Добавляет ребра ожиданий по паре вершин
-    void AddWaitingEdges(Graph& graph, size_t vertex_count){
-        for(size_t i = 0; i < vertex_count - 1; i += 2){
-            size_t edge_id = graph.AddEdge({i, i + 1, static_cast<Weight>(settings_.bus_wait_time_)});
+    // Номер остановки в каталоге, std::nullopt - если ее нет в справочнике
+    std::optional<StopId> FindStopId(std::string_view stop_name) const{
+        const Stop* stop = catalogue_->FindStop(stop_name);
+        if(stop == nullptr){
+            return std::nullopt;
+        }
+        return stop->id;
+    }
 
-            // Помимо добавления ребра, добавляется так же информация о том, что это за ребро (здесь ребро-ожидание)
-            edges_types_[edge_id] = std::make_shared<WaitEdge>("Wait"s, settings_.bus_wait_time_, std::string(id_stops_.at(i)));
+    // Маршрут между остановками, std::nullopt - если маршрута нет
+    // или какой-то остановки нет в справочнике
+    std::optional<DescribedRoute> BuildRoute(std::string_view from, std::string_view to) const{
+        const std::optional<StopId> from_id = FindStopId(from);
+        const std::optional<StopId> to_id = FindStopId(to);
+        if(!from_id || !to_id){
+            return std::nullopt;
+        }
+        return std::visit([&](const auto& router) -> std::optional<DescribedRoute>{
+            using Engine = std::decay_t<decltype(router)>;
+            if constexpr(std::is_same_v<Engine, std::monostate>){
+                return std::nullopt;
+            } else if constexpr(std::is_same_v<Engine, RaptorRouter<Weight>>){
+                auto journey = router.BuildRoute(*from_id, *to_id);
+                if(journey.has_value()){
+                    return DescribeJourney(*journey);
+                }
+                return std::nullopt;
+            } else {
+                const graph::VertexId from_vertex = stop_vertices_[*from_id];
+                const graph::VertexId to_vertex = stop_vertices_[*to_id];
+                if(from_vertex == NO_VERTEX || to_vertex == NO_VERTEX){
+                    // Остановки без маршрутов нет в графе, из нее можно попасть только в нее саму
+                    if(*from_id == *to_id){
+                        return DescribedRoute(Weight{}, {});
+                    }
+                    return std::nullopt;
+                }
+                // Между разными островами и против порядка компонент пути нет, поиск не нужен
+                if(!components_.MayReach(from_vertex, to_vertex)){
+                    return std::nullopt;
+                }
+                auto route = router.BuildRoute(from_vertex, to_vertex);
+                if(route.has_value()){
+                    return DescribeRoute(*route);
+                }
+                return std::nullopt;
+            }
+        }, router_);
+    }
+
+    // Время в пути от каждой остановки from до каждой остановки to без описания маршрутов.
+    // Движок считает всю матрицу сразу, а не ищет путь для каждой пары.
+    // std::nullopt - если какой-то остановки нет в справочнике
+    std::optional<WeightMatrix> BuildRouteMatrix(const std::vector<std::string>& from,
+                                                 const std::vector<std::string>& to) const{
+        std::optional<std::vector<StopId>> from_ids = GetStopIds(from);
+        std::optional<std::vector<StopId>> to_ids = GetStopIds(to);
+        if(!from_ids || !to_ids){
+            return std::nullopt;
+        }
+
+        return std::visit([&](const auto& router) -> std::optional<WeightMatrix>{
+            using Engine = std::decay_t<decltype(router)>;
+            if constexpr(std::is_same_v<Engine, std::monostate>){
+                return std::nullopt;
+            } else if constexpr(std::is_same_v<Engine, RaptorRouter<Weight>>){
+                // Один проход по раундам на каждую начальную остановку
+                WeightMatrix matrix;
+                matrix.reserve(from_ids->size());
+                for(StopId from_id : *from_ids){
+                    matrix.push_back(router.BuildArrivalTimes(from_id, *to_ids));
+                }
+                return matrix;
+            } else {
+                return BuildGraphMatrix(router, *from_ids, *to_ids);
+            }
+        }, router_);
+    }
+
+    // Все остановки, до которых из from можно доехать не более чем за max_time,
+    // по возрастанию времени. Один ограниченный поиск из from вместо маршрута
+    // до каждой остановки. std::nullopt - если остановки нет в справочнике
+    std::optional<ReachableStops> BuildReachable(std::string_view from, Weight max_time) const{
+        const Stop* from_stop = catalogue_->FindStop(from);
+        if(from_stop == nullptr){
+            return std::nullopt;
+        }
+
+        std::optional<ReachableStops> result = std::visit([&](const auto& router) -> std::optional<ReachableStops>{
+            using Engine = std::decay_t<decltype(router)>;
+            if constexpr(std::is_same_v<Engine, std::monostate>){
+                return std::nullopt;
+            } else if constexpr(std::is_same_v<Engine, RaptorRouter<Weight>>){
+                ReachableStops stops;
+                for(const auto& [stop, time] : router.BuildReachable(from_stop->id, max_time)){
+                    stops.emplace_back(stop->name, time);
+                }
+                return stops;
+            } else {
+                const graph::VertexId from_vertex = stop_vertices_[from_stop->id];
+                ReachableStops stops;
+                if(from_vertex == NO_VERTEX){
+                    // Из остановки без маршрутов достижима только она сама
+                    if(!(max_time < Weight{})){
+                        stops.emplace_back(from_stop->name, Weight{});
+                    }
+                    return stops;
+                }
+                // Из достигнутых вершин графа в ответ попадают только вершины остановок
+                for(const auto& reached : router.BuildReachable(from_vertex, max_time)){
+                    auto it = id_stops_.find(reached.vertex);
+                    if(it != id_stops_.end()){
+                        stops.emplace_back(it->second, reached.weight);
+                    }
+                }
+                return stops;
+            }
+        }, router_);
+
+        if(result.has_value()){
+            std::sort(result->begin(), result->end(), [](const auto& lhs, const auto& rhs){
+                return std::tie(lhs.second, lhs.first) < std::tie(rhs.second, rhs.first);
+            });
+        }
+        return result;
+    }
+
+    const RoutingSettings& GetSettings() const{
+        return settings_;
+    }
+
+    // Размеры компонент связности графа в остановках, по убыванию.
+    // Остановки не в графе не учитываются, для RAPTOR оба списка пусты
+    struct ComponentSizes{
+        std::vector<size_t> strong_;
+        std::vector<size_t> islands_;
+    };
+
+    ComponentSizes GetComponentSizes() const{
+        ComponentSizes sizes;
+        if(components_.IsEmpty()){
+            return sizes;
+        }
+        sizes.strong_.resize(components_.GetStrongComponentCount());
+        sizes.islands_.resize(components_.GetIslandCount());
+        for(graph::VertexId vertex : stop_vertices_){
+            if(vertex != NO_VERTEX){
+                ++sizes.strong_[components_.GetStrongComponent(vertex)];
+                ++sizes.islands_[components_.GetIsland(vertex)];
+            }
+        }
+        for(std::vector<size_t>* component_sizes : {&sizes.strong_, &sizes.islands_}){
+            std::sort(component_sizes->begin(), component_sizes->end(), std::greater<>());
+            // Компоненты только из вершин-позиций маршрутов остановок не содержат
+            while(!component_sizes->empty() && component_sizes->back() == 0){
+                component_sizes->pop_back();
+            }
+        }
+        return sizes;
+    }
+
+    // Маршрутизатор того же каталога с другими временем ожидания и скоростью.
+    // Граф заново не строится: топология разделяется, описания ребер и индексы
+    // остановок копируются, пересчитываются только веса ребер. Движок и его
+    // таблицы вычисляются заново, потому что зависят от весов
+    std::shared_ptr<const FrozenRouter> Reweight(const TransportCatalogue& catalogue, size_t bus_wait_time,
+                                                 size_t bus_velocity) const{
+        RoutingSettings settings = settings_;
+        settings.bus_wait_time_ = bus_wait_time;
+        settings.bus_velocity_ = bus_velocity;
+        std::shared_ptr<FrozenRouter> frozen(new FrozenRouter(settings));
+        frozen->catalogue_ = &catalogue;
+        frozen->edges_info_ = edges_info_;
+        frozen->stop_vertices_ = stop_vertices_;
+        frozen->id_stops_ = id_stops_;
+        frozen->components_ = components_;
+        frozen->topology_ = topology_;
+        if(settings.engine_ == RouterEngine::RAPTOR){
+            frozen->router_.template emplace<RaptorRouter<Weight>>(catalogue, frozen->GetWaitTime(), frozen->GetVelocity());
+        } else {
+            frozen->CreateRouter(frozen->BuildGraph(), catalogue);
+        }
+        return frozen;
+    }
+
+    // Сохраняет описания ребер, топологию и движок вместе с его таблицами
+    template<typename Writer>
+    void Save(Writer& writer) const{
+        writer.template Write<uint64_t>(edges_info_.size());
+        for(const EdgeInfo& info : edges_info_){
+            writer.Write(info.time);
+            writer.Write(info.index);
+            writer.Write(info.span_count);
+            writer.Write(info.type);
+        }
+        components_.Save(writer);
+        writer.Write(topology_ != nullptr);
+        if(topology_){
+            writer.template Write<uint64_t>(topology_->vertex_count);
+            writer.WriteVector(topology_->edges);
+        }
+
+        writer.template Write<uint64_t>(router_.index());
+        std::visit([&writer](const auto& router){
+            using Engine = std::decay_t<decltype(router)>;
+            if constexpr(!std::is_same_v<Engine, std::monostate> && !std::is_same_v<Engine, RaptorRouter<Weight>>){
+                router.Save(writer);
+            }
+        }, router_);
+    }
+
+    // Восстанавливает маршрутизатор, сохраненный Save, для того же каталога и настроек
+    template<typename Reader>
+    static std::shared_ptr<const FrozenRouter> Load(Reader& reader, const TransportCatalogue& catalogue,
+                                                    RoutingSettings settings){
+        std::shared_ptr<FrozenRouter> frozen(new FrozenRouter(settings));
+        frozen->catalogue_ = &catalogue;
+        frozen->edges_info_.resize(reader.template Read<uint64_t>());
+        for(EdgeInfo& info : frozen->edges_info_){
+            info.time = reader.template Read<Weight>();
+            info.index = reader.template Read<uint32_t>();
+            info.span_count = reader.template Read<uint16_t>();
+            info.type = reader.template Read<EdgeType>();
+            const size_t name_count = info.type == EdgeType::BUS ? catalogue.GetBuses().size() : catalogue.GetStops().size();
+            if(info.type > EdgeType::BUS || (info.type != EdgeType::ALIGHT && info.index >= name_count)){
+                throw std::runtime_error("Corrupted routing edge data");
+            }
+        }
+
+        frozen->components_ = graph::ComponentIndex::Load(reader);
+        if(reader.template Read<bool>()){
+            Topology topology;
+            topology.vertex_count = reader.template Read<uint64_t>();
+            topology.edges = reader.template ReadVector<graph::Edge<double>>();
+            const bool is_valid = std::all_of(topology.edges.begin(), topology.edges.end(), [&topology](const auto& edge){
+                return edge.from < topology.vertex_count && edge.to < topology.vertex_count;
+            });
+            if(!is_valid || topology.edges.size() != frozen->edges_info_.size()){
+                throw std::runtime_error("Corrupted routing topology data");
+            }
+            frozen->topology_ = std::make_shared<const Topology>(std::move(topology));
+        }
+
+        // Вершины остановок однозначно определяются каталогом и моделью графа
+        const size_t vertex_count = frozen->AddStopVertices(catalogue, settings.graph_model_ == GraphModel::STOP_PAIRS ? 2 : 1);
+        if(!frozen->components_.IsEmpty() && frozen->components_.GetVertexCount() < vertex_count){
+            throw std::runtime_error("Corrupted component index data");
+        }
+        frozen->LoadRouter(reader, catalogue, reader.template Read<uint64_t>());
+        return frozen;
+    }
+private:
+    // Топология графа: ребра с длиной в метрах вместо веса, у ожиданий и высадок
+    // длина 0. Не зависит от времени ожидания и скорости, поэтому общая
+    // у всех маршрутизаторов, перевзвешенных из одного. У RAPTOR ее нет
+    struct Topology{
+        size_t vertex_count = 0;
+        std::vector<graph::Edge<double>> edges;
+    };
+
+    explicit FrozenRouter(RoutingSettings settings)
+    : settings_(settings){}
+
+    template<typename Reader, size_t Index = 0>
+    void LoadRouter(Reader& reader, const TransportCatalogue& catalogue, size_t index){
+        if constexpr(Index < std::variant_size_v<RouterVariant>){
+            if(index != Index){
+                LoadRouter<Reader, Index + 1>(reader, catalogue, index);
+                return;
+            }
+            using Engine = std::variant_alternative_t<Index, RouterVariant>;
+            if constexpr(std::is_same_v<Engine, std::monostate>){
+                router_ = std::monostate{};
+            } else if constexpr(std::is_same_v<Engine, RaptorRouter<Weight>>){
+                // RAPTOR не хранит предвычислений, только индексы маршрутов
+                router_.template emplace<Engine>(catalogue, GetWaitTime(), GetVelocity());
+            } else {
+                router_.template emplace<Engine>(Engine::Load(reader));
+            }
+        } else {
+            throw std::runtime_error("Unknown routing engine in serialized data");
+        }
+    }
+
+    // Номера остановок по названиям, std::nullopt - если какой-то остановки нет
+    std::optional<std::vector<StopId>> GetStopIds(const std::vector<std::string>& names) const{
+        std::vector<StopId> ids;
+        ids.reserve(names.size());
+        for(const std::string& name : names){
+            std::optional<StopId> id = FindStopId(name);
+            if(!id){
+                return std::nullopt;
+            }
+            ids.push_back(*id);
+        }
+        return ids;
+    }
+
+    // Матрица движка по графу. Движок считает ее только для остановок, которые
+    // есть в графе, остановка без маршрутов достижима только из себя самой
+    template<typename Engine>
+    WeightMatrix BuildGraphMatrix(const Engine& router, const std::vector<StopId>& from_ids,
+                                  const std::vector<StopId>& to_ids) const{
+        const auto get_vertices = [this](const std::vector<StopId>& ids){
+            std::vector<graph::VertexId> vertices;
+            vertices.reserve(ids.size());
+            for(StopId id : ids){
+                if(stop_vertices_[id] != NO_VERTEX){
+                    vertices.push_back(stop_vertices_[id]);
+                }
+            }
+            return vertices;
+        };
+        const std::vector<graph::VertexId> from_vertices = get_vertices(from_ids);
+        const std::vector<graph::VertexId> to_vertices = get_vertices(to_ids);
+        WeightMatrix graph_matrix = router.BuildWeightMatrix(from_vertices, to_vertices);
+        if(from_vertices.size() == from_ids.size() && to_vertices.size() == to_ids.size()){
+            return graph_matrix;
+        }
+
+        WeightMatrix matrix(from_ids.size(), std::vector<std::optional<Weight>>(to_ids.size()));
+        size_t graph_row = 0;
+        for(size_t i = 0; i < from_ids.size(); ++i){
+            const bool is_from_in_graph = stop_vertices_[from_ids[i]] != NO_VERTEX;
+            size_t graph_column = 0;
+            for(size_t j = 0; j < to_ids.size(); ++j){
+                const bool is_to_in_graph = stop_vertices_[to_ids[j]] != NO_VERTEX;
+                if(is_from_in_graph && is_to_in_graph){
+                    matrix[i][j] = graph_matrix[graph_row][graph_column];
+                } else if(from_ids[i] == to_ids[j]){
+                    matrix[i][j] = Weight{};
+                }
+                graph_column += is_to_in_graph;
+            }
+            graph_row += is_from_in_graph;
+        }
+        return matrix;
+    }
+
+    // Создает движок поиска путей, выбранный в настройках. Для AUTO
+    // в настройках остается движок, выбранный по размеру графа
+    void CreateRouter(Graph graph, const TransportCatalogue& catalogue){
+        if(settings_.engine_ == RouterEngine::AUTO){
+            settings_.engine_ = ChooseEngine(graph);
+        }
+        switch(settings_.engine_){
+            case RouterEngine::ALL_PAIRS:
+                router_.template emplace<graph::Router<Weight>>(std::move(graph));
+                break;
+            case RouterEngine::ALL_PAIRS_COMPACT:
+                router_.template emplace<CompactRouter>(std::move(graph));
+                break;
+            case RouterEngine::ALL_PAIRS_BLOCKED:
+                router_.template emplace<graph::BlockedRouter<Weight>>(std::move(graph), GetThreadCount());
+                break;
+            case RouterEngine::ON_DEMAND:
+                router_.template emplace<graph::DijkstraRouter<Weight>>(std::move(graph));
+                break;
+            case RouterEngine::CONTRACTION_HIERARCHIES:
+                router_.template emplace<graph::ContractionHierarchyRouter<Weight>>(graph);
+                break;
+            case RouterEngine::A_STAR:{
+                // Скорость в метрах на единицу веса, как и в весах ребер-проездов
+                auto points = GetVertexPoints(catalogue, graph.GetVertexCount());
+                router_.template emplace<graph::AStarRouter<Weight>>(std::move(graph), std::move(points), GetVelocity());
+                break;
+            }
+            case RouterEngine::HUB_LABELS:
+                router_.template emplace<graph::HubLabelRouter<Weight>>(graph);
+                break;
+            case RouterEngine::RAPTOR:
+                // RAPTOR работает без графа и создается в CreateGraph
+                throw std::logic_error("RAPTOR engine doesn't use a routing graph");
+            case RouterEngine::AUTO:
+                throw std::logic_error("Routing engine should be chosen before creation");
+        }
+    }
+
+    // Таблица всех пар, если она помещается в бюджет памяти: ответ без поиска.
+    // Иначе иерархии сжатия, а если не помещаются и они - Дейкстра без предвычислений.
+    // Выбор и оценка памяти пишутся в std::clog
+    RouterEngine ChooseEngine(const Graph& graph) const{
+        const size_t vertex_count = graph.GetVertexCount();
+        const size_t edge_count = graph.GetEdgeCount();
+        const size_t budget = settings_.memory_budget_mb_ << 20;
+        const std::pair<RouterEngine, size_t> candidates[] = {
+            {RouterEngine::ALL_PAIRS, graph::Router<Weight>::EstimateMemory(vertex_count, edge_count)},
+            {RouterEngine::ALL_PAIRS_COMPACT, CompactRouter::EstimateMemory(vertex_count, edge_count)},
+            {RouterEngine::CONTRACTION_HIERARCHIES,
+             graph::ContractionHierarchyRouter<Weight>::EstimateMemory(vertex_count, edge_count)},
+            {RouterEngine::ON_DEMAND, Graph::EstimateMemory(vertex_count, edge_count)}
+        };
+
+        auto chosen = std::find_if(std::begin(candidates), std::end(candidates), [budget](const auto& candidate){
+            return candidate.second <= budget;
+        });
+        // Дейкстре нужен только сам граф, без него не обойтись
+        if(chosen == std::end(candidates)){
+            chosen = std::prev(std::end(candidates));
+        }
+        const auto to_mb = [](size_t size){
+            return size / double(1 << 20);
+        };
+        std::clog << "Routing engine auto: " << GetEngineName(chosen->first) << " for "
+                  << vertex_count << " vertices and " << edge_count << " edges, estimated "
+                  << to_mb(chosen->second) << " MB of " << settings_.memory_budget_mb_ << " MB budget (";
+        for(const auto& [engine, size] : candidates){
+            std::clog << GetEngineName(engine) << ' ' << to_mb(size) << " MB"
+                      << (engine == RouterEngine::ON_DEMAND ? ")" : ", ");
+        }
+        std::clog << std::endl;
+        return chosen->first;
+    }
+
+    // Положения вершин графа в метрах: точки остановок на сфере радиуса Земли.
+    // Расстояние между точками по прямой не больше расстояния geo::ComputeDistance
+    std::vector<typename graph::AStarRouter<Weight>::Point> GetVertexPoints(const TransportCatalogue& catalogue,
+                                                                            size_t vertex_count) const{
+        static const double dr = 3.1415926535 / 180.;
+        static const double earth_radius = 6371000;
+        const auto to_point = [](const geo::Coordinates& coords) -> typename graph::AStarRouter<Weight>::Point{
+            return {earth_radius * std::cos(coords.lat * dr) * std::cos(coords.lng * dr),
+                    earth_radius * std::cos(coords.lat * dr) * std::sin(coords.lng * dr),
+                    earth_radius * std::sin(coords.lat * dr)};
+        };
+
+        std::vector<typename graph::AStarRouter<Weight>::Point> points;
+        points.reserve(vertex_count);
+        const std::deque<Stop>& stops = catalogue.GetStops();
+        for(size_t stop_id = 0; stop_id < stops.size(); ++stop_id){
+            if(stop_vertices_[stop_id] == NO_VERTEX){
+                continue;
+            }
+            points.push_back(to_point(stops[stop_id].coords));
+            if(settings_.graph_model_ == GraphModel::STOP_PAIRS){
+                points.push_back(to_point(stops[stop_id].coords));
+            }
+        }
+        // Вершины-позиции модели шаблонов маршрутов находятся на своих остановках
+        if(settings_.graph_model_ == GraphModel::ROUTE_PATTERNS){
+            for(const Bus& bus : catalogue.GetBuses()){
+                if(bus.stops.size() < 2){
+                    continue;
+                }
+                for(const Stop* stop : bus.stops){
+                    points.push_back(to_point(stop->coords));
+                }
+            }
+        }
+        return points;
+    }
+
+    // Ожидание автобуса в единицах веса
+    Weight GetWaitTime() const{
+        return Units::FromMinutes(settings_.bus_wait_time_);
+    }
+
+    // Скорость автобуса в метрах на единицу веса
+    double GetVelocity() const{
+        return settings_.bus_velocity_ * 1000 / 60.0 / Units::PER_MINUTE;
+    }
+
+    size_t GetThreadCount() const{
+        if(settings_.thread_count_ != 0){
+            return settings_.thread_count_;
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Отводит step вершин подряд каждой остановке, через которую проходит
+    // маршрут хотя бы из двух остановок. Остальные остановки изолированы
+    // и в граф не попадают. Возвращает число отведенных вершин
+    size_t AddStopVertices(const TransportCatalogue& catalogue, size_t step){
+        const std::deque<Stop>& stops = catalogue.GetStops();
+        std::vector<bool> is_served(stops.size());
+        for(const Bus& bus : catalogue.GetBuses()){
+            if(bus.stops.size() > 1){
+                for(const Stop* stop : bus.stops){
+                    is_served[stop->id] = true;
+                }
+            }
+        }
+
+        stop_vertices_.assign(stops.size(), NO_VERTEX);
+        size_t vertex_count = 0;
+        for(size_t stop_id = 0; stop_id < stops.size(); ++stop_id){
+            if(is_served[stop_id]){
+                stop_vertices_[stop_id] = vertex_count;
+                id_stops_[vertex_count] = stops[stop_id].name;
+                vertex_count += step;
+            } else {
+                compaction_.dropped_vertex_count += step;
+            }
+        }
+        return vertex_count;
+    }
+
+    graph::VertexId GetStopVertex(const Stop* stop) const{
+        return stop_vertices_[stop->id];
+    }
+
+    // Пишет в std::clog число компонент связности графа и размеры наибольших
+    void LogComponents() const{
+        const ComponentSizes sizes = GetComponentSizes();
+        std::clog << "Routing graph components: " << sizes.strong_.size() << " strong (largest "
+                  << (sizes.strong_.empty() ? 0 : sizes.strong_.front()) << " stops), " << sizes.islands_.size()
+                  << " islands (largest " << (sizes.islands_.empty() ? 0 : sizes.islands_.front()) << " stops)" << std::endl;
+    }
+
+    // Граф с весами ребер по времени ожидания и скорости из настроек, упакованный
+    // в CSR. Времена в описаниях ребер обновляются теми же весами
+    Graph BuildGraph(){
+        // Скорость в метрах в минуту, как и при расчете расстояний
+        const double velocity = settings_.bus_velocity_ * 1000 / 60.0;
+        Graph graph(topology_->vertex_count);
+        for(size_t edge_id = 0; edge_id < topology_->edges.size(); ++edge_id){
+            const graph::Edge<double>& edge = topology_->edges[edge_id];
+            EdgeInfo& info = edges_info_[edge_id];
+            switch(info.type){
+                case EdgeType::ALIGHT:
+                    info.time = Weight{};
+                    break;
+                case EdgeType::WAIT:
+                    info.time = GetWaitTime();
+                    break;
+                case EdgeType::BUS:
+                    info.time = Units::FromMinutes(edge.weight / velocity);
+                    break;
+            }
+            graph.AddEdge({edge.from, edge.to, info.time});
+        }
+        // Граф больше не меняется, упаковываем его в CSR
+        graph.Freeze();
+        return graph;
+    }
+
+    // Пишет в std::clog размер графа без сжатия и после него: без изолированных
+    // остановок и без параллельных ребер-проездов, кроме самого короткого.
+    // Размер без сжатия - построенный граф вместе с отброшенными при построении
+    // вершинами и ребрами
+    void LogCompaction() const{
+        std::clog << "Routing graph compacted: " << topology_->vertex_count + compaction_.dropped_vertex_count
+                  << " -> " << topology_->vertex_count << " vertices, "
+                  << topology_->edges.size() + compaction_.dropped_edge_count << " -> "
+                  << topology_->edges.size() << " edges" << std::endl;
+    }
+
+    // Добавляет ребро длиной edge.weight метров в топологию, а его описание -
+    // в edges_info_ под тем же номером. Время ребра заполняет BuildGraph
+    void AddEdge(Topology& topology, const graph::Edge<double>& edge, EdgeType type, size_t index = 0, size_t span_count = 0){
+        topology.edges.push_back(edge);
+        edges_info_.push_back({Weight{}, static_cast<uint32_t>(index), static_cast<uint16_t>(span_count), type});
+    }
+
+    // Добавляет ребра ожиданий по паре вершин каждой остановки графа: из первой во вторую
+    void AddWaitingEdges(Topology& topology){
+        for(size_t stop_id = 0; stop_id < stop_vertices_.size(); ++stop_id){
+            const graph::VertexId vertex = stop_vertices_[stop_id];
+            if(vertex != NO_VERTEX){
+                AddEdge(topology, {vertex, vertex + 1, 0}, EdgeType::WAIT, stop_id);
+            } else {
+                ++compaction_.dropped_edge_count;
+            }
         }
     }
 
     // Возвращает расстояния от начала маршрута до каждой остановки маршрута
-    std::vector<int> GetBusDistances(const std::vector<const Stop*>& stops, const StopDistances& stop_distances){
+    std::vector<int> GetBusDistances(const std::vector<const Stop*>& stops, const TransportCatalogue& catalogue) const{
         size_t stop_count = stops.size();
         std::vector<int> distances(stop_count - 1);
         int summary_distance = 0;
         for(size_t i = 0; i < stop_count - 1; ++i){
-            PairStops key {stops[i], stops[i + 1]};
-            summary_distance += stop_distances.at(key);
+            summary_distance += catalogue.GetDistance(stops[i], stops[i + 1]);
             distances[i] = summary_distance;
         }
         return distances;
     }
     
-    // Добавляет остальные ребра между остановками
-    void AddBusesEdges(Graph& graph, const TransportCatalogue& catalogue){
-        std::deque<Bus> buses = catalogue.GetBuses();
-        StopDistances stop_distances = catalogue.GetStopDistances();
+    // Ребра-проезды одного маршрута и число проезжаемых остановок для каждого
+    using BusEdges = std::vector<std::pair<graph::Edge<double>, size_t>>;
+
+    // Ребра между всеми парами остановок маршрута, в порядке добавления в граф
+    BusEdges GetBusEdges(const Bus& bus, const TransportCatalogue& catalogue) const{
+        // Каждому маршруту соответствует свой набор остановок и дистанций между ними
+        const std::vector<const Stop*>& stops = bus.stops;
+        std::vector<int> distances = GetBusDistances(stops, catalogue);
+        BusEdges edges;
+        // Если у машрута N остановок, то N * (N - 1) ребер должно быть добавлено
+        edges.reserve(stops.size() * (stops.size() - 1) / 2);
+        for(size_t li = 0; li < stops.size() - 1; ++li){
+            const size_t from = GetStopVertex(stops[li]) + 1;
+            for(size_t ri = li + 1; ri < stops.size(); ++ri){
+                int distance = distances[ri - 1];
+                size_t to = GetStopVertex(stops[ri]);
+
+                // Разница между индексами ri и li - есть количество проезжаемых остановок на автобусе
+                edges.emplace_back(graph::Edge<double>{from, to, static_cast<double>(distance)}, ri - li);
+            }
+            // После прохода по всем остановкам, начальная остановка сдвигается,
+            // а расстояния уменьшаются на величину значения от прошлой начальной остановки
+            int old_distance = distances[li];
+            for(int& dist : distances){
+                dist -= old_distance;
+            }
+        }
+        return edges;
+    }
+
+    // Добавляет остальные ребра между остановками. Ребра маршрутов собираются
+    // параллельно, каждый маршрут в свой буфер. Из параллельных ребер остается
+    // самое короткое, при равенстве - первое, вместе со своим маршрутом. Скорость
+    // у всех автобусов одна, поэтому при любой скорости оно же и самое быстрое.
+    // Отбор тоже параллельный: вершины from делятся на непересекающиеся диапазоны,
+    // а оставшиеся ребра добавляются в граф в порядке первого появления пары вершин
+    // (по маршрутам), поэтому номера ребер не зависят от числа потоков
+    void AddBusesEdges(Topology& topology, const TransportCatalogue& catalogue){
+        const std::deque<Bus>& buses = catalogue.GetBuses();
+        CheckSpanCounts(buses);
+        const size_t thread_count = GetThreadCount();
+        const size_t vertex_count = topology.vertex_count;
+
+        std::vector<BusEdges> buses_edges(buses.size());
+        // Начала отрезков ребер маршрута с общей вершиной from
+        std::vector<std::vector<size_t>> buses_runs(buses.size());
+        graph::ParallelFor(buses.size(), thread_count, [&](size_t index){
+            if(buses[index].stops.size() < 2){
+                return;
+            }
+            buses_edges[index] = GetBusEdges(buses[index], catalogue);
+            const BusEdges& edges = buses_edges[index];
+            for(size_t i = 0; i < edges.size(); ++i){
+                if(i == 0 || edges[i].first.from != edges[i - 1].first.from){
+                    buses_runs[index].push_back(i);
+                }
+            }
+        });
+
+        // Отрезки раскладываются подсчетом по вершине from,
+        // внутри одной вершины они идут в порядке маршрутов
+        struct Run{
+            size_t bus_index;
+            size_t begin;
+            size_t end;
+        };
+        std::vector<size_t> run_offsets(vertex_count + 1, 0);
+        // Номер первого ребра маршрута в общем порядке всех ребер
+        std::vector<size_t> bus_offsets(buses.size() + 1, 0);
+        for(size_t bus_index = 0; bus_index < buses.size(); ++bus_index){
+            bus_offsets[bus_index + 1] = bus_offsets[bus_index] + buses_edges[bus_index].size();
+            for(size_t begin : buses_runs[bus_index]){
+                ++run_offsets[buses_edges[bus_index][begin].first.from + 1];
+            }
+        }
+        std::partial_sum(run_offsets.begin(), run_offsets.end(), run_offsets.begin());
+        std::vector<Run> runs(run_offsets.back());
+        std::vector<size_t> run_ends(run_offsets.begin(), run_offsets.end() - 1);
+        for(size_t bus_index = 0; bus_index < buses.size(); ++bus_index){
+            const std::vector<size_t>& bus_runs = buses_runs[bus_index];
+            for(size_t i = 0; i < bus_runs.size(); ++i){
+                const size_t end = i + 1 < bus_runs.size() ? bus_runs[i + 1] : buses_edges[bus_index].size();
+                const graph::VertexId from = buses_edges[bus_index][bus_runs[i]].first.from;
+                runs[run_ends[from]++] = {bus_index, bus_runs[i], end};
+            }
+        }
+        std::vector<std::vector<size_t>>().swap(buses_runs);
+
+        // Ребро-проезд вместе с маршрутом, числом проезжаемых остановок
+        // и местом первого появления своей пары вершин
+        struct Ride{
+            graph::Edge<double> edge;
+            size_t bus_index;
+            size_t span_count;
+            size_t position;
+        };
+        const size_t shard_count = std::max<size_t>(std::min(thread_count, vertex_count), 1);
+        std::vector<std::vector<Ride>> shards_rides(shard_count);
+        std::vector<size_t> shards_dropped(shard_count, 0);
+        graph::ParallelFor(shard_count, thread_count, [&](size_t shard){
+            std::vector<Ride>& rides = shards_rides[shard];
+            // Для вершины to: последняя вершина from с ребром в нее и позиция этого ребра в rides
+            std::vector<graph::VertexId> ride_from(vertex_count, NO_VERTEX);
+            std::vector<size_t> ride_positions(vertex_count);
+            const size_t from_end = vertex_count * (shard + 1) / shard_count;
+            for(size_t from = vertex_count * shard / shard_count; from < from_end; ++from){
+                for(size_t run_index = run_offsets[from]; run_index < run_offsets[from + 1]; ++run_index){
+                    const Run& run = runs[run_index];
+                    for(size_t i = run.begin; i < run.end; ++i){
+                        const auto& [edge, span_count] = buses_edges[run.bus_index][i];
+                        if(ride_from[edge.to] != from){
+                            ride_from[edge.to] = from;
+                            ride_positions[edge.to] = rides.size();
+                            rides.push_back({edge, run.bus_index, span_count, bus_offsets[run.bus_index] + i});
+                            continue;
+                        }
+                        // Параллельное ребро: одно из двух отбрасывается
+                        ++shards_dropped[shard];
+                        Ride& ride = rides[ride_positions[edge.to]];
+                        if(edge.weight < ride.edge.weight){
+                            ride.edge = edge;
+                            ride.bus_index = run.bus_index;
+                            ride.span_count = span_count;
+                        }
+                    }
+                }
+            }
+        });
+        std::vector<BusEdges>().swap(buses_edges);
+
+        std::vector<Ride> rides;
+        rides.reserve(std::accumulate(shards_rides.begin(), shards_rides.end(), size_t{0},
+                                      [](size_t sum, const std::vector<Ride>& shard_rides){
+                                          return sum + shard_rides.size();
+                                      }));
+        for(size_t shard = 0; shard < shard_count; ++shard){
+            rides.insert(rides.end(), shards_rides[shard].begin(), shards_rides[shard].end());
+            std::vector<Ride>().swap(shards_rides[shard]);
+            compaction_.dropped_edge_count += shards_dropped[shard];
+        }
+        std::sort(rides.begin(), rides.end(), [](const Ride& lhs, const Ride& rhs){
+            return lhs.position < rhs.position;
+        });
+        for(const Ride& ride : rides){
+            AddEdge(topology, ride.edge, EdgeType::BUS, ride.bus_index, ride.span_count);
+        }
+    }
 
+    // Число проезжаемых остановок хранится в описании ребра в 16 битах
+    void CheckSpanCounts(const std::deque<Bus>& buses) const{
         for(const Bus& bus : buses){
-            // Каждому маршруту соответствует свой набор остановок и дистанций между ними
-            const std::vector<const Stop*>& stops = bus.stops;
-            std::vector<int> distances = GetBusDistances(stops, stop_distances);
-            // Если у машрута N остановок, то N * (N - 1) ребер должно быть добавлено
-            for(size_t li = 0; li < stops.size() - 1; ++li){
-                for(size_t ri = li + 1; ri < stops.size(); ++ri){
-                    int distance = distances[ri - 1];
-                    double time = distance / (settings_.bus_velocity_ * 1000 / 60.0);
-                    size_t from = stops_id_.at(stops[li]->name) + 1;
-                    size_t to = stops_id_.at(stops[ri]->name);
-                    size_t edge_id = graph.AddEdge({from, to, time});
+            if(bus.stops.size() > std::numeric_limits<uint16_t>::max()){
+                throw std::length_error("Too many stops on bus route: "s + bus.name);
+            }
+        }
+    }
+
+    // Добавляет ребра модели шаблонов маршрутов. Вершина first_ride_vertex + k
+    // соответствует k-й позиции (автобус, остановка) по всем маршрутам подряд
+    void AddRoutePatternEdges(Topology& topology, const TransportCatalogue& catalogue, size_t first_ride_vertex){
+        size_t ride_vertex = first_ride_vertex;
 
-                    // Помимо добавления ребра, добавляется так же информация о том, что это за ребро (здесь ребро-маршрут)
-                    // Разница между индексами ri и li - есть количество проезжаемых остановок на автобусе
-                    edges_types_[edge_id] = std::make_shared<BusEdge>("Bus"s, time, bus.name, ri - li);
+        const std::deque<Bus>& buses = catalogue.GetBuses();
+        for(size_t bus_index = 0; bus_index < buses.size(); ++bus_index){
+            const std::vector<const Stop*>& stops = buses[bus_index].stops;
+            // Маршрут из одной остановки никуда не везет, вершины ему не отводятся
+            if(stops.size() < 2){
+                continue;
+            }
+            for(size_t i = 0; i < stops.size(); ++i, ++ride_vertex){
+                const StopId stop_id = stops[i]->id;
+                const graph::VertexId stop_vertex = stop_vertices_[stop_id];
+                // Высадка на остановке ничего не стоит и в описание маршрута не попадает
+                if(i > 0){
+                    AddEdge(topology, {ride_vertex, stop_vertex, 0}, EdgeType::ALIGHT);
                 }
-                // После прохода по всем остановкам, начальная остановка сдвигается,
-                // а расстояния уменьшаются на величину значения от прошлой начальной остановки
-                int old_distance = distances[li];
-                for(int& dist : distances){
-                    dist -= old_distance;
+                if(i + 1 == stops.size()){
+                    continue;
                 }
+                // Посадка: ожидание автобуса на остановке
+                AddEdge(topology, {stop_vertex, ride_vertex, 0}, EdgeType::WAIT, stop_id);
+
+                // Проезд до следующей остановки маршрута, подряд идущие
+                // проезды объединяются в описании маршрута
+                const double distance = catalogue.GetDistance(stops[i], stops[i + 1]);
+                AddEdge(topology, {ride_vertex, ride_vertex + 1, distance}, EdgeType::BUS, bus_index, 1);
             }
         }
     }
 
-    DescribedRoute DescribeRoute(const RouteInfo& route){
-        std::vector<std::shared_ptr<BaseEdge>> items;
+    // Описание маршрута RAPTOR: ожидание перед каждой поездкой и сама поездка
+    DescribedRoute DescribeJourney(const typename RaptorRouter<Weight>::Journey& journey) const{
+        std::vector<RouteItem> items;
+        items.reserve(2 * journey.legs.size());
+        for(const auto& leg : journey.legs){
+            items.push_back({EdgeType::WAIT, GetWaitTime(), leg.board_stop->name});
+            items.push_back({EdgeType::BUS, leg.ride_time, leg.bus->name, leg.span_count});
+        }
+        return {journey.total_time, std::move(items)};
+    }
+
+    DescribedRoute DescribeRoute(const RouteInfo& route) const{
+        std::vector<RouteItem> items;
+        // Последний элемент - поездка, которую можно продолжить следующим ребром-проездом
+        bool is_riding = false;
 
-        for(size_t edge_id : route.edges){
-            items.push_back(edges_types_.at(edge_id));
+        for(graph::EdgeId edge_id : route.edges){
+            const EdgeInfo& info = edges_info_[edge_id];
+            switch(info.type){
+                case EdgeType::ALIGHT:
+                    is_riding = false;
+                    break;
+                case EdgeType::WAIT:
+                    is_riding = false;
+                    items.push_back({EdgeType::WAIT, info.time, catalogue_->GetStops()[info.index].name});
+                    break;
+                case EdgeType::BUS:
+                    if(is_riding){
+                        // Продолжение поездки на том же автобусе
+                        items.back().time_ += info.time;
+                        items.back().span_count_ += info.span_count;
+                    } else {
+                        is_riding = true;
+                        items.push_back({EdgeType::BUS, info.time, catalogue_->GetBuses()[info.index].name, info.span_count});
+                    }
+                    break;
+            }
         }
         return {route.weight, std::move(items)};
     }
-    
-    // Для хранения ребер и информации о нем
-    std::unordered_map<size_t, std::shared_ptr<BaseEdge>> edges_types_;
 
-    // Для хранения и нумерации остановок
-    std::unordered_map<std::string_view, int> stops_id_;
-    std::unordered_map<int, std::string_view> id_stops_;
+    // Описание ребра графа: вид, вес и номер в каталоге остановки
+    // ожидания или маршрута поездки. 16 байт для вещественных весов
+    struct EdgeInfo{
+        Weight time;
+        uint32_t index;
+        uint16_t span_count;
+        EdgeType type;
+    };
+
+    // Описания ребер по номеру ребра графа
+    std::vector<EdgeInfo> edges_info_;
+    std::shared_ptr<const Topology> topology_;
+    // Каталог, по номерам которого описаны ребра. Названия остановок
+    // и маршрутов в ответах ссылаются на его строки
+    const TransportCatalogue* catalogue_ = nullptr;
+    // Первая вершина каждой остановки, NO_VERTEX - изолированная остановка не в графе
+    std::vector<graph::VertexId> stop_vertices_;
+    // Названия остановок по вершинам графа
+    std::unordered_map<graph::VertexId, std::string_view> id_stops_;
+    // Компоненты связности графа для мгновенного ответа об отсутствии маршрута
+    graph::ComponentIndex components_;
+    // Сколько вершин и ребер сжатие отбросило при построении, только для LogCompaction
+    struct CompactionStats{
+        size_t dropped_vertex_count = 0;
+        size_t dropped_edge_count = 0;
+    };
+    CompactionStats compaction_;
+    static constexpr graph::VertexId NO_VERTEX = std::numeric_limits<graph::VertexId>::max();
 
     RoutingSettings settings_;
-    std::optional<graph::Router<Weight>> router_;
+    RouterVariant router_;
 };
 
 } // namespace transport_router